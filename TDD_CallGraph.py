@@ -0,0 +1,151 @@
+# !/usr/bin/env python3
+# coding = utf-8
+
+import json
+import os
+import sys
+from typing import Dict, List, Set, Tuple
+
+class CallGraph:
+    """
+    cross-TU call graph built from the caller -> callees sets of __TDDAnalysis.json.
+    functions are numbered by their sorted names, edges are kept in CSR form.
+    """
+    __slots__ = ("_names", "_nameIdx", "_offsets", "_targets", "_sccOf", "_sccCount", "_reachCount")
+    _names : List[str]
+    _nameIdx : Dict[str, int]
+    _offsets : List[int]
+    _targets : List[int]
+    _sccOf : List[int]
+    _sccCount : int
+    _reachCount : List[int]
+
+    def __init__(self, analysis : Dict[str, List[str]]):
+        nameSet : Set[str] = set(analysis.keys())
+        for callees in analysis.values():
+            nameSet.update(callees)
+        self._names = sorted(nameSet)
+        self._nameIdx = {name : idx for idx, name in enumerate(self._names)}
+        self._offsets = [0]
+        self._targets = []
+        for name in self._names:
+            callees = sorted(set(self._nameIdx[callee] for callee in analysis.get(name, ())))
+            self._targets.extend(callees)
+            self._offsets.append(len(self._targets))
+        self._sccOf = []
+        self._sccCount = 0
+        self._reachCount = []
+        self.computeSCC()
+        self.computeReach()
+
+    def successors(self, idx : int) -> List[int]:
+        return self._targets[self._offsets[idx] : self._offsets[idx + 1]]
+
+    def computeSCC(self):
+        """
+        iterative tarjan, SCCs are numbered in reverse topological order (callees first).
+        """
+        nodeCount = len(self._names)
+        index = [-1] * nodeCount
+        lowLink = [0] * nodeCount
+        onStack = [False] * nodeCount
+        stack : List[int] = []
+        self._sccOf = [-1] * nodeCount
+        nextIndex = 0
+        for root in range(nodeCount):
+            if index[root] != -1:
+                continue
+            workList : List[Tuple[int, int]] = [(root, self._offsets[root])]
+            index[root] = lowLink[root] = nextIndex
+            nextIndex += 1
+            stack.append(root)
+            onStack[root] = True
+            while workList:
+                node, edgeIdx = workList[-1]
+                if edgeIdx < self._offsets[node + 1]:
+                    workList[-1] = (node, edgeIdx + 1)
+                    succ = self._targets[edgeIdx]
+                    if index[succ] == -1:
+                        index[succ] = lowLink[succ] = nextIndex
+                        nextIndex += 1
+                        stack.append(succ)
+                        onStack[succ] = True
+                        workList.append((succ, self._offsets[succ]))
+                    elif onStack[succ]:
+                        lowLink[node] = min(lowLink[node], index[succ])
+                else:
+                    workList.pop()
+                    if workList:
+                        parent = workList[-1][0]
+                        lowLink[parent] = min(lowLink[parent], lowLink[node])
+                    if lowLink[node] == index[node]:
+                        while True:
+                            member = stack.pop()
+                            onStack[member] = False
+                            self._sccOf[member] = self._sccCount
+                            if member == node:
+                                break
+                        self._sccCount += 1
+
+    def computeReach(self):
+        """
+        number of distinct functions reachable from each function (itself included).
+        reachable sets are python ints used as bitsets over functions, one per SCC.
+        """
+        sccMembers : List[List[int]] = [[] for _ in range(self._sccCount)]
+        for node, scc in enumerate(self._sccOf):
+            sccMembers[scc].append(node)
+        sccReach : List[int] = [0] * self._sccCount
+        sccReachCount : List[int] = [0] * self._sccCount
+        # callees get smaller SCC numbers, so increasing order visits them first
+        for scc in range(self._sccCount):
+            reach = 0
+            for member in sccMembers[scc]:
+                reach |= 1 << member
+            for member in sccMembers[scc]:
+                for succ in self.successors(member):
+                    if self._sccOf[succ] != scc:
+                        reach |= sccReach[self._sccOf[succ]]
+            sccReach[scc] = reach
+            sccReachCount[scc] = bin(reach).count("1")
+        self._reachCount = [sccReachCount[scc] for scc in self._sccOf]
+
+    def reachCount(self, name : str) -> int:
+        if name not in self._nameIdx:
+            return 0
+        return self._reachCount[self._nameIdx[name]]
+
+    def dump(self, fileName : str, apis : List[str]):
+        apiReach = sorted(((name, self.reachCount(name)) for name in apis), key = lambda x : (-x[1], x[0]))
+        dic = {
+            "names" : self._names,
+            "offsets" : self._offsets,
+            "targets" : self._targets,
+            "scc" : self._sccOf,
+            "sccCount" : self._sccCount,
+            "reach" : self._reachCount,
+            "apiReach" : dict(apiReach),
+        }
+        with open(fileName, "wt") as f:
+            json.dump(dic, f, separators = (",", ":"))
+
+def loadReachFromFile(fileName = "__TDDCallGraph.json") -> Dict[str, int]:
+    """
+    API name -> reachable function count, empty if the call graph was not computed.
+    """
+    if not os.path.exists(fileName):
+        return {}
+    with open(fileName, "rt") as f:
+        return json.load(f)["apiReach"]
+
+if __name__ == "__main__":
+    analysisFile = sys.argv[1] if len(sys.argv) >= 2 else "__TDDAnalysis.json"
+    declarationsFile = sys.argv[2] if len(sys.argv) >= 3 else "__TDDDeclarations.json"
+    with open(analysisFile, "rt") as f:
+        graph = CallGraph(json.load(f))
+    apis : List[str] = []
+    if os.path.exists(declarationsFile):
+        with open(declarationsFile, "rt") as f:
+            apis = list(json.load(f).keys())
+    graph.dump("__TDDCallGraph.json", apis)
+    print(f"{len(graph._names)} functions, {len(graph._targets)} calls, {graph._sccCount} SCCs, {len(apis)} APIs")
@@ -0,0 +1,133 @@
+# !/usr/bin/env python3
+# coding = utf-8
+
+import os
+import shlex
+import subprocess
+import sys
+from typing import Dict, List, Tuple
+
+class SelectorConfig:
+    # configs
+    EXEC_TIMEOUT   : int = 60
+    LLVM_PROFDATA  : str = f"{os.environ['LLVM_DIR']}/build_release/bin/llvm-profdata" if os.environ.get("LLVM_DIR") else "llvm-profdata"
+    LLVM_COV       : str = f"{os.environ['LLVM_DIR']}/build_release/bin/llvm-cov" if os.environ.get("LLVM_DIR") else "llvm-cov"
+    SELECTED_FILE  : str = "__TDDSelectedChains"
+    # args
+    TARGETS  : List[str] = []
+    EXCLUDES : List[str] = []
+    REPLAYS  : List[Tuple[str, List[str]]] = []
+    OBJECTS  : List[str] = []
+
+    def __init__(self):
+        assert False, "class SelectorConfig can NOT be initialized"
+
+def readConfigFile(fileName = "__TDDCaseConfig"):
+    """
+    reads "$ target" (source directories / files, "!" excludes) and "$ replay" :
+    one case per line, the calling chain it produced followed by the command replaying it.
+    "$ replay objects" lists the instrumented shared libraries the cases load (e.g. libmagic.so),
+    their coverage is only exported if llvm-cov gets them next to the executable.
+    the replayed binaries must be built with the coverage flags of `set.py fuzzing`.
+    """
+    assert os.path.exists(fileName), f"{fileName} does not exist"
+    mode = ""
+    with open(fileName, "rt") as f:
+        for line in f:
+            line = line.strip()
+            if not line or line.startswith("# "):
+                continue
+            elif line.startswith("$"):
+                mode = line
+            elif mode == "$ target":
+                if line.startswith("!"):
+                    SelectorConfig.EXCLUDES.append(os.path.realpath(line[1 :]))
+                else:
+                    SelectorConfig.TARGETS.append(os.path.realpath(line))
+            elif mode == "$ replay":
+                chainFile, *command = shlex.split(line)
+                assert command, f"replay of {chainFile} has no command"
+                SelectorConfig.REPLAYS.append((chainFile, command))
+            elif mode == "$ replay objects":
+                SelectorConfig.OBJECTS.append(os.path.realpath(line))
+    assert SelectorConfig.REPLAYS, f"no \"$ replay\" in {fileName}"
+
+def isTarget(sourceFile : str) -> bool:
+    sourceFile = os.path.realpath(sourceFile)
+    def under(path : str) -> bool:
+        return sourceFile == path or sourceFile.startswith(path + os.sep)
+    if any(under(path) for path in SelectorConfig.EXCLUDES):
+        return False
+    return not SelectorConfig.TARGETS or any(under(path) for path in SelectorConfig.TARGETS)
+
+def replayCoverage(idx : int, command : List[str]) -> List[Tuple[str, int]]:
+    """
+    covered (file, line) of the target code for one replayed case, empty if the case produced no profile.
+    """
+    rawFile = f"__TDDReplay.{idx}.profraw"
+    dataFile = f"__TDDReplay.{idx}.profdata"
+    for fileName in (rawFile, dataFile):
+        if os.path.exists(fileName):
+            os.remove(fileName)
+    env = dict(os.environ, LLVM_PROFILE_FILE = rawFile)
+    try:
+        subprocess.run(command, env = env, stdout = subprocess.DEVNULL, stderr = subprocess.DEVNULL, timeout = SelectorConfig.EXEC_TIMEOUT)
+    except subprocess.TimeoutExpired:
+        print(f"[WARNING] {' '.join(command)} timeout in {SelectorConfig.EXEC_TIMEOUT} seconds")
+    if not os.path.exists(rawFile):
+        print(f"[WARNING] {' '.join(command)} wrote no profile")
+        return []
+    subprocess.run([SelectorConfig.LLVM_PROFDATA, "merge", "-sparse", rawFile, "-o", dataFile], check = True)
+    objects = [arg for library in SelectorConfig.OBJECTS for arg in ("-object", library)]
+    lcov = subprocess.run([SelectorConfig.LLVM_COV, "export", "-format=lcov", f"-instr-profile={dataFile}", command[0], *objects],
+                          check = True, stdout = subprocess.PIPE).stdout.decode("utf-8", errors = "replace")
+    ret : List[Tuple[str, int]] = []
+    sourceFile = ""
+    keep = False
+    for line in lcov.splitlines():
+        if line.startswith("SF:"):
+            sourceFile = line[3 :]
+            keep = isTarget(sourceFile)
+        elif keep and line.startswith("DA:"):
+            lineNo, count = line[3 :].split(",")[: 2]
+            if int(count) > 0:
+                ret.append((sourceFile, int(lineNo)))
+    return ret
+
+def greedyCover(coverage : Dict[str, int], sizes : Dict[str, int]) -> List[str]:
+    """
+    greedy set cover over line bitsets : repeatedly take the chain adding the most uncovered lines,
+    ties go to the shorter chain. stops once no chain adds anything.
+    """
+    covered = 0
+    ret : List[str] = []
+    left = dict(coverage)
+    while left:
+        chainFile, gain = max(((name, bin(lines & ~covered).count("1")) for name, lines in left.items()),
+                              key = lambda x : (x[1], -sizes[x[0]], x[0]))
+        if gain == 0:
+            break
+        ret.append(chainFile)
+        covered |= left.pop(chainFile)
+    return ret
+
+if __name__ == "__main__":
+    readConfigFile(sys.argv[1] if len(sys.argv) >= 2 else "__TDDCaseConfig")
+    lineIdx : Dict[Tuple[str, int], int] = {}
+    coverage : Dict[str, int] = {}
+    sizes : Dict[str, int] = {}
+    for idx, (chainFile, command) in enumerate(SelectorConfig.REPLAYS):
+        assert os.path.exists(chainFile), f"{chainFile} does not exist"
+        bits = 0
+        for line in replayCoverage(idx, command):
+            bits |= 1 << lineIdx.setdefault(line, len(lineIdx))
+        coverage[chainFile] = coverage.get(chainFile, 0) | bits
+        sizes[chainFile] = os.path.getsize(chainFile)
+        print(f"{chainFile} : {bin(bits).count('1')} lines")
+    selected = greedyCover(coverage, sizes)
+    if not selected:
+        print("[WARNING] no target line covered, keep all chains")
+        selected = list(coverage.keys())
+    with open(SelectorConfig.SELECTED_FILE, "wt") as f:
+        f.write("\n".join(selected) + "\n")
+    print(f"{len(selected)} / {len(coverage)} chains cover all {len(lineIdx)} target lines : {' '.join(selected)}")
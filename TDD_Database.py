@@ -0,0 +1,107 @@
+# !/usr/bin/env python3
+# coding = utf-8
+
+import json
+import os
+import struct
+import sys
+from typing import Dict, List, Tuple
+
+# layout written by TDD_NewSuite.cc, one entry file per TU
+DATABASE_DIR   : str   = "__TDDDatabase"
+DATABASE_MAGIC : bytes = b"TDDDB004"
+
+class DatabaseEntry:
+    __slots__ = ("declStamp", "decl", "depStamp", "dep")
+    declStamp : int
+    decl : str
+    depStamp : int
+    dep : str
+
+def loadEntry(fileName : str) -> Tuple[str, DatabaseEntry]:
+    """
+    the TU path and entry of one entry file, the path is None for an entry of another schema version.
+    """
+    with open(fileName, "rb") as f:
+        data = f.read()
+    if data[: len(DATABASE_MAGIC)] != DATABASE_MAGIC:
+        return None, None
+    pos = len(DATABASE_MAGIC)
+
+    def readUInt64() -> int:
+        nonlocal pos
+        value, = struct.unpack_from("<Q", data, pos)
+        pos += 8
+        return value
+
+    def readString() -> str:
+        nonlocal pos
+        size = readUInt64()
+        value = data[pos : pos + size].decode("utf-8")
+        pos += size
+        return value
+
+    path = readString()
+    entry = DatabaseEntry()
+    entry.declStamp = readUInt64()
+    entry.decl = readString()
+    entry.depStamp = readUInt64()
+    entry.dep = readString()
+    return path, entry
+
+def loadDatabase(dirName = DATABASE_DIR) -> Dict[str, DatabaseEntry]:
+    assert os.path.isdir(dirName), f"{dirName} does not exist, compile with TDD_DUMP_DECL=1 or TDD_GET_DEP=1 first"
+    ret : Dict[str, DatabaseEntry] = {}
+    stale = 0
+    for fileName in sorted(os.listdir(dirName)):
+        # files still being written end with .tmp
+        if not fileName.endswith(".bin"):
+            continue
+        path, entry = loadEntry(os.path.join(dirName, fileName))
+        if path is None:
+            stale += 1
+        else:
+            ret[path] = entry
+    if stale:
+        print(f"{stale} entries of another schema version are skipped, compile their TUs again", file = sys.stderr)
+    return ret
+
+def materialize(db : Dict[str, DatabaseEntry]) -> Tuple[int, int]:
+    """
+    write __TDDDeclarations.json / __TDDAnalysis.json from all TUs that still exist.
+    return the number of declarations and analyzed functions.
+    """
+    declarations : Dict = {}
+    analysis : Dict = {}
+    for path in sorted(db.keys()):
+        if not os.path.exists(path):
+            continue
+        entry = db[path]
+        if entry.declStamp:
+            declarations.update(json.loads(entry.decl))
+        if entry.depStamp:
+            analysis.update(json.loads(entry.dep))
+    # declarations are keyed by mangled name, overloads share their qualified name
+    overloads : Dict[str, List[str]] = {}
+    for key, declaration in declarations.items():
+        overloads.setdefault(declaration.get("name", key), []).append(key)
+    for key, declaration in declarations.items():
+        declaration["overloads"] = sorted(overloads[declaration.get("name", key)])
+    if declarations:
+        with open("__TDDDeclarations.json", "wt") as f:
+            json.dump(declarations, f, separators = (",", ":"))
+    if analysis:
+        with open("__TDDAnalysis.json", "wt") as f:
+            json.dump(analysis, f, separators = (",", ":"))
+    return len(declarations), len(analysis)
+
+if __name__ == "__main__":
+    db = loadDatabase()
+    if len(sys.argv) == 2 and sys.argv[1] == "list":
+        for path, entry in sorted(db.items()):
+            print(f"{path} decl={entry.declStamp:016x} dep={entry.depStamp:016x}")
+    elif len(sys.argv) == 1:
+        declCount, depCount = materialize(db)
+        print(f"{len(db)} TUs, {declCount} declarations, {depCount} analyzed functions")
+    else:
+        raise ValueError(f"Usage : python {sys.argv[0]} [list]")
@@ -2,6 +2,7 @@
 # coding = utf-8
 
 import enum
+import glob
 import json
 import os
 import random
@@ -26,16 +27,38 @@ class GlobalConfig:
     LOG_LEVEL            : MyLogLevel = MyLogLevel.LOG_HINT
     EXEC_TIMEOUT         : int        = 20
     CC_FILE              : str        = "__TDDDriver.cc"
+    # sharded drivers : the part shared by every translation unit (precompiled), the pointers of the chain
+    # they share too (not precompiled) and the makefile building them in parallel
+    HEADER_FILE          : str        = "__TDDDriver.h"
+    POINTERS_FILE        : str        = "__TDDDriver.pointers.h"
+    MAKE_FILE            : str        = "__TDDDriver.mk"
+    OBJ_FILE             : str        = "__TDDDriver.o"
     EXE_FILE             : str        = "__TDDDriver.exe"
-    DRIVER_COMPILE_FLAGS : str        = "-gdwarf-4 -fstandalone-debug -O0 -DNDEBUG -Xclang -disable-O0-optnone -fPIC -fsanitize=address,fuzzer -fprofile-instr-generate -fcoverage-mapping -std=c++17"
+    COVERAGE_EXE_FILE    : str        = "__TDDDriver.cov.exe"
+    # throughput : the glue at -O2 without coverage, libFuzzer and the profile runtime of the target linked in
+    DRIVER_COMPILE_FLAGS : str        = "-gdwarf-4 -O2 -DNDEBUG -fPIC -fsanitize=address -std=c++17"
+    DRIVER_LINK_FLAGS    : str        = "-fsanitize=address,fuzzer -fprofile-instr-generate"
+    # coverage reports and debugging : everything at -O0 with coverage mapping
+    COVERAGE_FLAGS       : str        = "-gdwarf-4 -fstandalone-debug -O0 -DNDEBUG -Xclang -disable-O0-optnone -fPIC -fsanitize=address,fuzzer -fprofile-instr-generate -fcoverage-mapping -std=c++17"
     DRIVER_SKELETON      : Path       = Path() / os.environ["TDD"] / "TDD_DriverSkeleton.cc"
+    SHARED_SKELETON      : Path       = Path() / os.environ["TDD"] / "TDD_DriverSkeleton.h"
+    SHARED_BEGIN         : str        = "// TDD driver, the part shared by"
+    SHARED_END           : str        = "#endif // __TDD_DRIVER_SHARED\n"
+    POINTERS_BEGIN       : str        = "// TDD driver, the pointers of the calling chain"
+    POINTERS_END         : str        = "#endif // __TDD_DRIVER_POINTERS\n"
     # args
     PRE_OPERATIONS : str  = ""
     FLAGS          : str  = ""
+    # FLAGS split into the lines the compiler needs and the rest (libraries, objects, linker options)
+    COMPILE_FLAGS  : str  = ""
+    LINK_FLAGS     : str  = ""
     MIN_SIZE       : int  = 256
     MAX_SIZE       : int  = 4096
     NO_CONST_INT   : bool = False
     OPAQUE_TYPES   : str  = ""
+    SETUP_REUSE    : bool = True
+    # node translation units, 1 writes a single __TDDDriver.cc
+    SHARDS         : int  = 1
 
     def __init__(self):
         assert False, "class GlobalConfig can NOT be initialized"
@@ -51,6 +74,8 @@ def readConfigFile(fileName = "__TDDCaseConfig"):
         MODE_MAX_SIZE     = enum.auto()
         MODE_NO_CONST_INT = enum.auto()
         MODE_OPAQUE_TYPES = enum.auto()
+        MODE_NO_SETUP     = enum.auto()
+        MODE_SHARDS       = enum.auto()
     mode = Mode.MODE_UNKNOWN
     preOperations = []
     flags = []
@@ -58,6 +83,8 @@ def readConfigFile(fileName = "__TDDCaseConfig"):
     maxSize = 4096
     noConstInt = False
     opaqueTypes = ""
+    setupReuse = True
+    shards = 1
     with open(fileName, "rt") as f:
         for line in f:
             line = line.strip()
@@ -75,6 +102,10 @@ def readConfigFile(fileName = "__TDDCaseConfig"):
                 mode = Mode.MODE_NO_CONST_INT
             elif line == "$ opaque types":
                 mode = Mode.MODE_OPAQUE_TYPES
+            elif line == "$ no setup reuse":
+                mode = Mode.MODE_NO_SETUP
+            elif line == "$ driver shards":
+                mode = Mode.MODE_SHARDS
             elif line.startswith("$"):
                 # other flags
                 mode = Mode.MODE_UNKNOWN
@@ -94,17 +125,28 @@ def readConfigFile(fileName = "__TDDCaseConfig"):
                         noConstInt = False
                 elif mode == Mode.MODE_OPAQUE_TYPES:
                     opaqueTypes += f"struct {line} {{}};\n"
+                elif mode == Mode.MODE_NO_SETUP:
+                    setupReuse = not line.startswith("1")
+                elif mode == Mode.MODE_SHARDS:
+                    shards = int(line)
                 else:
                     # other configs
                     pass
 
     assert minSize <= maxSize, f"minSize : {minSize} > maxSize : {maxSize}"
+    assert shards >= 1, f"driver shards : {shards} < 1"
     GlobalConfig.PRE_OPERATIONS = "\n".join(preOperations)
     GlobalConfig.FLAGS = " ".join(flags)
+    # linker inputs only go to the link step, everything else to both
+    isLinkInput = lambda flag : flag.startswith(("-l", "-L", "-Wl,")) or flag.endswith((".a", ".so", ".o")) or ".so." in flag
+    GlobalConfig.COMPILE_FLAGS = " ".join(flag for flag in flags if not isLinkInput(flag))
+    GlobalConfig.LINK_FLAGS = " ".join(flags)
     GlobalConfig.MIN_SIZE = minSize
     GlobalConfig.MAX_SIZE = maxSize
     GlobalConfig.NO_CONST_INT = noConstInt
     GlobalConfig.OPAQUE_TYPES = opaqueTypes
+    GlobalConfig.SETUP_REUSE = setupReuse
+    GlobalConfig.SHARDS = shards
 
 class CMDFormat:
     """
@@ -231,24 +273,115 @@ class CMDFormat:
         else:
             return 0
 
+def splitShards(nodes : List[str], shardCount : int) -> List[List[str]]:
+    """
+    consecutive nodes into shardCount non-empty translation units of about the same amount of code.
+    """
+    total = sum(len(node) for node in nodes)
+    shards : List[List[str]] = [[]]
+    done = 0
+    for idx, node in enumerate(nodes):
+        full = done >= total * len(shards) / shardCount or len(nodes) - idx == shardCount - len(shards)
+        if shards[-1] and len(shards) < shardCount and full:
+            shards.append([])
+        shards[-1].append(node)
+        done += len(node)
+    return shards
+
+def writeIfChanged(fileName : str, content : str):
+    """
+    keeps the modification time of a file whose content is the same, so make does not rebuild it.
+    """
+    if os.path.exists(fileName):
+        with open(fileName, "rt") as f:
+            if f.read() == content:
+                return
+    with open(fileName, "wt") as f:
+        f.write(content)
+
+def writeMakefile(sources : List[str]):
+    """
+    builds the sharded driver with make -j : the shared header is precompiled once and
+    every translation unit compiles against it. "coverage" builds the coverage profile.
+    the pointers header changes with the chain, it is included but not precompiled.
+    """
+    pch = f"{GlobalConfig.HEADER_FILE}.pch"
+    lines = [
+        f"# generated by TDD_DriverGenerator.py : make -f {GlobalConfig.MAKE_FILE} -j$(nproc) [coverage]",
+        "CXX            = $(LLVM_DIR)/build_release/bin/clang++",
+        f"DRIVER_FLAGS   = {GlobalConfig.DRIVER_COMPILE_FLAGS}",
+        f"LINK_FLAGS     = {GlobalConfig.DRIVER_LINK_FLAGS}",
+        f"COVERAGE_FLAGS = {GlobalConfig.COVERAGE_FLAGS}",
+        f"COMPILE_FLAGS  = {GlobalConfig.COMPILE_FLAGS}",
+        f"LIBS           = {GlobalConfig.LINK_FLAGS}",
+        f"SOURCES        = {' '.join(sources)}",
+        "",
+        f"all : {GlobalConfig.EXE_FILE}",
+        f"coverage : {GlobalConfig.COVERAGE_EXE_FILE}",
+        ".PHONY : all coverage",
+        "",
+        f"{pch} : {GlobalConfig.HEADER_FILE}",
+        "\t$(CXX) $(DRIVER_FLAGS) -x c++-header -o $@ $< $(COMPILE_FLAGS)",
+        "",
+        f"%.cov.o : %.cc {GlobalConfig.HEADER_FILE} {GlobalConfig.POINTERS_FILE}",
+        "\t$(CXX) $(COVERAGE_FLAGS) -c -o $@ $< $(COMPILE_FLAGS)",
+        "",
+        f"%.o : %.cc {pch} {GlobalConfig.POINTERS_FILE}",
+        f"\t$(CXX) $(DRIVER_FLAGS) -include {GlobalConfig.HEADER_FILE} -c -o $@ $< $(COMPILE_FLAGS)",
+        "",
+        f"{GlobalConfig.EXE_FILE} : $(SOURCES:.cc=.o)",
+        "\t$(CXX) $(LINK_FLAGS) -o $@ $^ $(LIBS)",
+        "",
+        f"{GlobalConfig.COVERAGE_EXE_FILE} : $(SOURCES:.cc=.cov.o)",
+        "\t$(CXX) $(COVERAGE_FLAGS) -o $@ $^ $(LIBS)",
+    ]
+    writeIfChanged(GlobalConfig.MAKE_FILE, "\n".join(line.rstrip() for line in lines) + "\n")
+
+def splitQualifiedName(name : str) -> Tuple[str, str]:
+    """
+    "a::B<c::D>::f" -> ("a::B<c::D>", "f"), "::" inside template arguments is not a separator.
+    """
+    depth = 0
+    lastNameSpacePos = -1
+    for pos, c in enumerate(name):
+        if c == "<":
+            depth += 1
+        elif c == ">":
+            depth -= 1
+        elif depth == 0 and name.startswith("::", pos):
+            lastNameSpacePos = pos
+    assert lastNameSpacePos != -1, f"{name} is not a qualified name"
+    return name[: lastNameSpacePos], name[lastNameSpacePos + 2 :]
+
 class FunctionDecl:
     class FunctionDeclType(enum.Enum):
         NORMAL_OR_STATIC = enum.auto()
         CXX_CONSTRUCTOR  = enum.auto()
         CXX_METHOD       = enum.auto()
 
-    __slots__ = ("_name", "_returnType", "_parametersType", "_isCXXMethod", "_base", "_isStaticMethod", "_isCXXConstructor", "_isTemplate", "_templateArgs")
+    __slots__ = ("_key", "_name", "_pointerType", "_overloads", "_returnType", "_parametersType", "_parametersConstraint", "_isCXXMethod", "_base", "_isStaticMethod", "_isCXXConstructor", "_isConstMethod", "_isTemplate", "_templateArgs")
+    _key : str
     _name : str
+    _pointerType : str
+    _overloads : Tuple[str, ...]
     _returnType : str
     _parametersType : Tuple[str, ...]
+    _parametersConstraint : Tuple[Dict, ...]
     _isCXXMethod : int
     _base : str
     _isStaticMethod : int
     _isCXXConstructor : int
-
-    def __init__(self, name : str, d: Dict):
+    _isConstMethod : int
+
+    def __init__(self, key : str, d: Dict):
+        # key is the mangled name, name the qualified name with template arguments
+        self._key = key
+        name = d.get("name", key)
+        self._pointerType = d.get("pointerType", "")
+        self._overloads = tuple(d.get("overloads", (key, )))
         self._parametersType = tuple(s.replace(" ", "") for s in d["parametersType"])
         self._returnType = d["returnType"].replace(" ", "")
+        self._parametersConstraint = tuple(d.get("parametersConstraint", ({}, ) * len(self._parametersType)))
 
         self._isCXXMethod = d["isCXXMethod"]
         if self._isCXXMethod:
@@ -256,14 +389,25 @@ class FunctionDecl:
             if self._isStaticMethod:
                 self._name = name
             else:
-                lastNameSpacePos = name.rfind("::")
-                assert lastNameSpacePos != -1
-                self._name = name[lastNameSpacePos + 2 :]
-                self._base = name[: lastNameSpacePos]
+                self._base, self._name = splitQualifiedName(name)
                 self._isCXXConstructor = d["isCXXConstructor"]
+                self._isConstMethod = d["isConstMethod"]
         else:
             self._name = name
 
+    @property
+    def name(self) -> str:
+        return self._name
+
+    @property
+    def callee(self) -> str:
+        """
+        expression naming a free or static function, overloads are told apart by a cast.
+        """
+        if len(self._overloads) > 1 and self._pointerType:
+            return f"(static_cast<{self._pointerType}>(&{self._name}))"
+        return self._name
+
     @property
     def returnType(self) -> str:
         return self._returnType
@@ -272,6 +416,10 @@ class FunctionDecl:
     def parametersType(self) -> Tuple[str, ...]:
         return self._parametersType
 
+    @property
+    def parametersConstraint(self) -> Tuple[Dict, ...]:
+        return self._parametersConstraint
+
     @property
     def isCXXMethod(self) -> int:
         return self._isCXXMethod
@@ -290,6 +438,11 @@ class FunctionDecl:
         assert self._isCXXMethod == 1
         return self._isCXXConstructor
 
+    @property
+    def isConstMethod(self) -> int:
+        assert self.functionType == FunctionDecl.FunctionDeclType.CXX_METHOD
+        return self._isConstMethod
+
     @property
     def functionType(self) -> FunctionDeclType:
         if not self._isCXXMethod:
@@ -397,6 +550,172 @@ class FunctionCall:
     def parameters(self) -> List[FunctionParameter]:
         return self._parameters
 
+def allocReadsInput(parameterType : str) -> bool:
+    """
+    __TDD_driver_typed_alloc fills byte buffers from the input and zeroes everything else.
+    typedefs of byte types are not seen here, the driver turns the reuse off if one is read.
+    """
+    pointee = parameterType[: -1] if parameterType.endswith(("*", "&")) else parameterType
+    while pointee.startswith(("const", "volatile")):
+        pointee = pointee[5 :] if pointee.startswith("const") else pointee[8 :]
+    return pointee in ("void", "char", "signedchar", "unsignedchar", "int8_t", "uint8_t", "bool", "std::byte")
+
+def isReadOnlyPointer(constraint : Dict) -> bool:
+    """
+    a pointer or reference to const, nothing it points to is written through it.
+    the parameter types lose their qualifiers, the plugin keeps it as the pointeeConst constraint.
+    """
+    return bool(constraint.get("pointeeConst", 0))
+
+def isReleaseLikeName(name : str) -> bool:
+    name = splitQualifiedName(name)[1].lower() if "::" in name else name.lower()
+    return any(word in name for word in ("free", "destroy", "done", "delete", "release", "close", "dispose", "unref", "cleanup", "deinit", "shutdown"))
+
+def pairArguments(call : FunctionCall, decl : FunctionDecl) -> List[Tuple]:
+    """
+    (argument or None, parameter type, constraint) of a call, paired the way generateArguments does,
+    the object pointer first.
+    """
+    pairs : List[Tuple] = []
+    arguments = call.parameters
+    if decl.functionType != FunctionDecl.FunctionDeclType.NORMAL_OR_STATIC:
+        pairs.append((arguments[0], f"{decl.base}*", {}))
+        arguments = arguments[1 :]
+    arguments = {argument.idx : argument for argument in arguments}
+    for idx, (parameterType, constraint) in enumerate(zip(decl.parametersType, decl.parametersConstraint)):
+        pairs.append((arguments.get(idx), parameterType, constraint))
+    return pairs
+
+def pointerStorageTypes(ous : Dict, decls : Dict[str, FunctionDecl]) -> List[str]:
+    """
+    the type of every pointer id in TDD_Driver_Pointers : the return type of the nodes producing it,
+    else the type all arguments use it as at offset 0, else void*.
+    """
+    returned : Dict[int, set] = {}
+    used : Dict[int, set] = {}
+    for node in ous["nodes"][1 :]:
+        call = FunctionCall(node)
+        decl = decls[call.name]
+        if call.returnIdx != -1:
+            returned.setdefault(call.returnIdx, set()).add(decl.returnType)
+        for argument, parameterType, _ in pairArguments(call, decl):
+            if argument is not None and argument.paramType == FunctionCall.FunctionParameterType.PTR:
+                used.setdefault(argument.ptrIndex, set()).add(parameterType if argument.offset == 0 else "")
+    ret : List[str] = []
+    for ptrIndex in range(ous["pointerIdxCount"]):
+        types = returned.get(ptrIndex, used.get(ptrIndex, set()))
+        storageType = next(iter(types)) if len(types) == 1 else ""
+        # function pointers and other declarators keep void*
+        ret.append(storageType if storageType.endswith(("*", "&")) else "void*")
+    return ret
+
+def classifySetupNodes(ous : Dict, decls : Dict[str, FunctionDecl]) -> Tuple[List[int], List[int]]:
+    """
+    nodes that read no input and whose results are only read later, in an order they can run in.
+    every predecessor is node 0 or a setup node, pointer arguments come from setup nodes or are
+    fresh buffers no other node passes directly (later nodes only load from them), and no result
+    reaches a release-like function other than a teardown node.
+    teardown nodes are release-like nodes reading no input whose pointers all come from setup nodes
+    (FT_Done_FreeType of a setup FT_Init_FreeType), the driver skips them while it reuses the setup
+    results and runs them once when it releases them.
+    """
+    nodeCount = len(ous["nodes"])
+    # node 0 is the graph root without a call
+    calls : List[FunctionCall] = [None] + [FunctionCall(node) for node in ous["nodes"][1 :]]
+    predecessors : List[List[int]] = [[] for _ in range(nodeCount)]
+    for fromIdx, toIdx in ous["edges"]:
+        predecessors[toIdx].append(fromIdx)
+    loadedFrom : Dict[int, int] = {dst : src for (src, _), dst in ous["loadPtrs"]}
+    returned = set(call.returnIdx for call in calls[1 :] if call.returnIdx != -1)
+    users : Dict[int, set] = {}
+    for nodeIdx in range(1, nodeCount):
+        for argument in calls[nodeIdx].parameters:
+            if argument.paramType == FunctionCall.FunctionParameterType.PTR:
+                users.setdefault(argument.ptrIndex, set()).add(nodeIdx)
+    releaseNodes = [nodeIdx for nodeIdx in range(1, nodeCount) if isReleaseLikeName(calls[nodeIdx].name)]
+    # pointers handed to a release-like function and everything they are loaded from
+    def releasedBy(nodeIdx : int) -> set:
+        ret = set()
+        for argument in calls[nodeIdx].parameters:
+            if argument.paramType == FunctionCall.FunctionParameterType.PTR:
+                ptrIndex = argument.ptrIndex
+                ret.add(ptrIndex)
+                while ptrIndex in loadedFrom:
+                    ptrIndex = loadedFrom[ptrIndex]
+                    ret.add(ptrIndex)
+        return ret
+    released = set()
+    available = set()
+    def isAvailable(ptrIndex : int) -> bool:
+        while ptrIndex not in available and ptrIndex in loadedFrom:
+            ptrIndex = loadedFrom[ptrIndex]
+        return ptrIndex in available
+    def readsNoInput(nodeIdx : int, fresh : List[int]) -> bool:
+        call = calls[nodeIdx]
+        decl = decls[call.name]
+        pairs = pairArguments(call, decl)
+        if call.returnIdx in released:
+            return False
+        # parameters passed as a pointer id before, a sizeOf constraint only reads no input after one of them
+        pointerParameters = set()
+        for pairIdx, (argument, parameterType, constraint) in enumerate(pairs):
+            isObject = pairIdx == 0 and decl.functionType != FunctionDecl.FunctionDeclType.NORMAL_OR_STATIC
+            if argument is not None and argument.paramType == FunctionCall.FunctionParameterType.PTR and not isObject:
+                pointerParameters.add(argument.idx)
+            if parameterType in ("FILE*", "std::string"):
+                return False
+            elif argument is None:
+                if constraint.get("sizeOf", -1) in pointerParameters or (constraint.get("nonnull", 0) and not allocReadsInput(parameterType)):
+                    continue
+                return False
+            elif argument.paramType == FunctionCall.FunctionParameterType.CONST:
+                if GlobalConfig.NO_CONST_INT:
+                    return False
+            elif argument.paramType == FunctionCall.FunctionParameterType.FILE_PATH:
+                return False
+            elif argument.paramType == FunctionCall.FunctionParameterType.NULL:
+                if constraint.get("nonnull", 0) and allocReadsInput(parameterType):
+                    return False
+            elif argument.paramType == FunctionCall.FunctionParameterType.PTR:
+                if isAvailable(argument.ptrIndex):
+                    continue
+                if argument.ptrIndex in returned or argument.ptrIndex in loadedFrom or argument.ptrIndex in released or allocReadsInput(parameterType):
+                    return False
+                if users[argument.ptrIndex] != {nodeIdx}:
+                    return False
+                fresh.append(argument.ptrIndex)
+        return True
+
+    def isTeardown(nodeIdx : int) -> bool:
+        fresh : List[int] = []
+        return readsNoInput(nodeIdx, fresh) and not fresh and all(isAvailable(argument.ptrIndex) for argument in calls[nodeIdx].parameters
+                                                                  if argument.paramType == FunctionCall.FunctionParameterType.PTR)
+
+    # released only grows : fewer setup nodes, fewer teardown nodes, more released pointers
+    while True:
+        setupNodes : List[int] = []
+        available.clear()
+        isSetup = [False] * nodeCount
+        isSetup[0] = True
+        changed = GlobalConfig.SETUP_REUSE
+        while changed:
+            changed = False
+            for nodeIdx in range(1, nodeCount):
+                fresh : List[int] = []
+                if isSetup[nodeIdx] or nodeIdx in releaseNodes or not all(isSetup[fromIdx] for fromIdx in predecessors[nodeIdx]) or not readsNoInput(nodeIdx, fresh):
+                    continue
+                isSetup[nodeIdx] = True
+                setupNodes.append(nodeIdx)
+                available.update(fresh)
+                if calls[nodeIdx].returnIdx != -1:
+                    available.add(calls[nodeIdx].returnIdx)
+                changed = True
+        teardownNodes = [nodeIdx for nodeIdx in releaseNodes if setupNodes and isTeardown(nodeIdx)]
+        stillReleased = set(ptrIndex for nodeIdx in releaseNodes if nodeIdx not in teardownNodes for ptrIndex in releasedBy(nodeIdx))
+        if stillReleased <= released:
+            return setupNodes, teardownNodes
+        released |= stillReleased
+
 if __name__ == "__main__":
     readConfigFile()
     decls : Dict[str, FunctionDecl] = {}
@@ -408,36 +727,122 @@ if __name__ == "__main__":
 
     with open(str(GlobalConfig.DRIVER_SKELETON), "rt") as f:
         skeleton = f.read()
-    skeleton = skeleton.replace("// @@ DRIVER COMPILE COMMAND @@", f"$LLVM_DIR/build_release/bin/clang++ {GlobalConfig.DRIVER_COMPILE_FLAGS} -o {GlobalConfig.EXE_FILE} {GlobalConfig.CC_FILE} {GlobalConfig.FLAGS}")
+    with open(str(GlobalConfig.SHARED_SKELETON), "rt") as f:
+        skeleton = skeleton.replace("// @@ SHARED PART @@", f.read())
+    # one node per shard at most, node 0 has no code
+    shardCount = max(1, min(GlobalConfig.SHARDS, len(ous["nodes"]) - 1))
+    shardFiles = [f"{Path(GlobalConfig.CC_FILE).stem}.{idx}.cc" for idx in range(shardCount)] if shardCount > 1 else []
+    # shards, header and makefile of an earlier generation, the reproducer would include stale shards
+    stem = Path(GlobalConfig.CC_FILE).stem
+    staleFiles = [fileName for fileName in glob.glob(f"{stem}.*.cc") if re.fullmatch(rf"{re.escape(stem)}\.\d+\.cc", fileName) and fileName not in shardFiles]
+    if not shardFiles:
+        staleFiles += [fileName for fileName in (GlobalConfig.HEADER_FILE, GlobalConfig.POINTERS_FILE, GlobalConfig.MAKE_FILE) if os.path.exists(fileName)]
+    for fileName in staleFiles:
+        os.remove(fileName)
+    clang = "$LLVM_DIR/build_release/bin/clang++"
+    if shardFiles:
+        skeleton = skeleton.replace("// @@ DRIVER COMPILE COMMAND @@", f"make -f {GlobalConfig.MAKE_FILE} -j$(nproc)")
+    else:
+        skeleton = skeleton.replace("// @@ DRIVER COMPILE COMMAND @@", f"{clang} {GlobalConfig.DRIVER_COMPILE_FLAGS} -c -o {GlobalConfig.OBJ_FILE} {GlobalConfig.CC_FILE} {GlobalConfig.COMPILE_FLAGS}".rstrip() + f" && {clang} {GlobalConfig.DRIVER_LINK_FLAGS} -o {GlobalConfig.EXE_FILE} {GlobalConfig.OBJ_FILE} {GlobalConfig.LINK_FLAGS}".rstrip())
+    skeleton = skeleton.replace("// @@ COVERAGE COMPILE COMMAND @@", f"{clang} {GlobalConfig.COVERAGE_FLAGS} -o {GlobalConfig.COVERAGE_EXE_FILE} {' '.join([GlobalConfig.CC_FILE] + shardFiles)} {GlobalConfig.FLAGS}")
     skeleton = skeleton.replace("// @@ MIN SIZE @@", f"{GlobalConfig.MAX_SIZE}").replace("// @@ MAX SIZE @@", f"{GlobalConfig.MAX_SIZE}")
     skeleton = skeleton.replace("// @@ PRE OPERATIONS @@", f"{GlobalConfig.PRE_OPERATIONS}")
     skeleton = skeleton.replace("// @@ OPAQUE TYPES @@", f"{GlobalConfig.OPAQUE_TYPES}")
     skeleton = skeleton.replace("/* @@ GRAPH NODE COUNT @@ */", f"{len(ous['nodes'])}")
     skeleton = skeleton.replace("/* @@ POINTER COUNT @@ */", f"{ous['pointerIdxCount']}")
+    nodeWeights = ous.get("nodeWeights", [1] * len(ous["nodes"]))
+    skeleton = skeleton.replace("/* @@ NODE WEIGHTS @@ */", ", ".join(str(weight) for weight in nodeWeights))
 
-    ptrLoads : List[str] = []
-    graphEdges : List[str] = []
     graphNodes : List[str] = []
 
-    def addPtrLoadInDriver(loadPair : Tuple[Tuple[int, int], int]):
-        return f"    __TDD_load_ptr[{loadPair[1]}] = {{{loadPair[0][0]}, {loadPair[0][1]}}};"
-    for loadPair in ous["loadPtrs"]:
-        ptrLoads.append(addPtrLoadInDriver(loadPair))
-    ptrLoadsStr = "\n".join(ptrLoads)
-    skeleton = skeleton.replace("// @@ PTR LOADS @@", ptrLoadsStr)
-
-    def addEdgeInDriver(edge : Tuple[int, int]) -> str:
-        return f"    __TDD_graph.addEdge({edge[0]}, {edge[1]});"
-    for edge in ous["edges"]:
-        graphEdges.append(addEdgeInDriver(edge))
-    graphEdgesStr = "\n".join(graphEdges)
-    skeleton = skeleton.replace("// @@ GRAPH EDGES @@", graphEdgesStr)
+    # typed pointer storage, and one loader per loaded pointer after the loader of its source
+    storageTypes = pointerStorageTypes(ous, decls)
+    pointerFields = "\n    ".join(f"__TDD_storage_t<{storageType}> ptr_{ptrIndex} = nullptr;" for ptrIndex, storageType in enumerate(storageTypes))
+    skeleton = skeleton.replace("// @@ POINTER FIELDS @@", pointerFields)
+    pointerOffsets = [f"offsetof(TDD_Driver_Pointers, ptr_{ptrIndex})" for ptrIndex in range(len(storageTypes))] + ["0"]
+    skeleton = skeleton.replace("/* @@ POINTER OFFSETS @@ */", ", ".join(pointerOffsets))
+    loadedFrom : Dict[int, Tuple[int, int]] = {dst : (src, offset) for (src, offset), dst in ous["loadPtrs"]}
+    pointerLoaders : List[str] = []
+    def addPointerLoader(dst : int):
+        if any(loader.startswith(f"inline bool __TDD_load_ptr_{dst} ") for loader in pointerLoaders):
+            return
+        src, offset = loadedFrom[dst]
+        if src in loadedFrom:
+            addPointerLoader(src)
+            srcCheck = f"    if (!__TDD_ptrs.ptr_{src} && !__TDD_load_ptr_{src}()) return false;"
+        else:
+            srcCheck = f"    if (!__TDD_ptrs.ptr_{src}) {{\n        __TDD_driver_null_ptr({src});\n        return false;\n    }}"
+        pointerLoaders.append(f"inline bool __TDD_load_ptr_{dst} () {{\n{srcCheck}\n"
+                              f"    __TDD_ptrs.ptr_{dst} = *(__TDD_storage_t<{storageTypes[dst]}>*) (((char*) (__TDD_ptrs.ptr_{src})) + {offset});\n"
+                              f"    if (!__TDD_ptrs.ptr_{dst}) {{\n        __TDD_driver_null_ptr({dst});\n        return false;\n    }}\n"
+                              f"    return true;\n}}\n")
+    for dst in sorted(loadedFrom):
+        addPointerLoader(dst)
+    # pointer id -> loaded pointers reading it directly or through other loads, cleared by nodes that may write it
+    loadedThrough : Dict[int, List[int]] = {}
+    for dst in sorted(loadedFrom):
+        src = loadedFrom[dst][0]
+        while True:
+            loadedThrough.setdefault(src, []).append(dst)
+            if src not in loadedFrom:
+                break
+            src = loadedFrom[src][0]
+    skeleton = skeleton.replace("// @@ POINTER LOADERS @@", "\n".join(pointerLoaders))
+
+    # CSR scheduling graph, edges keep their order per node
+    nodeCount = len(ous["nodes"])
+    successors : List[List[int]] = [[] for _ in range(nodeCount)]
+    inDegrees : List[int] = [0] * nodeCount
+    for fromIdx, toIdx in ous["edges"]:
+        successors[fromIdx].append(toIdx)
+        inDegrees[toIdx] += 1
+    graphOffsets : List[int] = [0]
+    graphTargets : List[int] = []
+    for subSuccessors in successors:
+        graphTargets.extend(subSuccessors)
+        graphOffsets.append(len(graphTargets))
+    skeleton = skeleton.replace("/* @@ GRAPH OFFSETS @@ */", ", ".join(str(offset) for offset in graphOffsets))
+    skeleton = skeleton.replace("/* @@ GRAPH TARGETS @@ */", ", ".join(str(target) for target in graphTargets + ["__TDD_UNEG1"]))
+    skeleton = skeleton.replace("/* @@ GRAPH IN DEGREES @@ */", ", ".join(str(inDegree) for inDegree in inDegrees))
+
+    setupNodes, teardownNodes = classifySetupNodes(ous, decls)
+    skeleton = skeleton.replace("/* @@ SETUP NODES @@ */", ", ".join(str(node) for node in setupNodes + ["__TDD_UNEG1"]))
+    skeleton = skeleton.replace("/* @@ TEARDOWN NODES @@ */", ", ".join(str(node) for node in teardownNodes + ["__TDD_UNEG1"]))
 
     commands : List[str] = []
     tempVarIdx = 0
     lastPointerIndex = -1
     args : List[int] = []
-    def addArgument(argument : FunctionCall.FunctionParameter, parameterType : str):
+    paramPointerIndex : Dict[int, int] = {}
+    writtenPointers : List[int] = []
+    def addEnumArgument(parameterType : str, constraint : Dict):
+        global commands, tempVarIdx
+        values = ", ".join(str(value) for value in constraint["enumValues"])
+        isFlag = "true" if constraint.get("isFlagEnum", 0) else "false"
+        commands.append(f"{parameterType} __TDD_tempVar_{tempVarIdx} = ({parameterType}) (__TDD_driver_enum_value({{{values}}}, {isFlag}));")
+        args.append(tempVarIdx)
+        tempVarIdx += 1
+    def addNonnullArgument(parameterType : str):
+        global commands, tempVarIdx
+        commands.append(f"uint64_t __TDD_tempSize_{tempVarIdx} = 0;")
+        commands.append(f"{parameterType} __TDD_tempVar_{tempVarIdx} = ({parameterType}) (__TDD_driver_typed_alloc<{parameterType}>(__TDD_tempSize_{tempVarIdx}));")
+        args.append(tempVarIdx)
+        tempVarIdx += 1
+    def getPointer(parameterType : str, ptrIndex : int, offset : int, constraint : Dict) -> str:
+        """
+        loads or allocates pointer id ptrIndex, the expression of it as parameterType.
+        """
+        global commands
+        if not isReadOnlyPointer(constraint):
+            writtenPointers.append(ptrIndex)
+        if ptrIndex in loadedFrom:
+            commands.append(f"if (!__TDD_ptrs.ptr_{ptrIndex} && !__TDD_load_ptr_{ptrIndex}()) return false;")
+        else:
+            commands.append(f"__TDD_driver_alloc_ptr<{parameterType}>(__TDD_ptrs.ptr_{ptrIndex}, __TDD_ptrs.size[{ptrIndex}]);")
+        if offset == 0 and parameterType.endswith("*") and parameterType == storageTypes[ptrIndex]:
+            return f"__TDD_ptrs.ptr_{ptrIndex}"
+        return f"({parameterType}) (__TDD_driver_get_typed_object<{parameterType}>(__TDD_ptrs.ptr_{ptrIndex}, {offset}))"
+    def addArgument(argument : FunctionCall.FunctionParameter, parameterType : str, constraint : Dict):
         global commands, tempVarIdx, lastPointerIndex
         if parameterType == "FILE*":
             commands.append(f"{parameterType} __TDD_tempVar_{tempVarIdx} = ({parameterType}) (__TDD_driver_FILEptr());")
@@ -447,6 +852,8 @@ if __name__ == "__main__":
             commands.append(f"{parameterType} __TDD_tempVar_{tempVarIdx} = ({parameterType}) (__TDD_driver_std_string());")
             args.append(tempVarIdx)
             tempVarIdx += 1
+        elif argument.paramType == FunctionCall.FunctionParameterType.CONST and GlobalConfig.NO_CONST_INT and "enumValues" in constraint:
+            addEnumArgument(parameterType, constraint)
         elif argument.paramType == FunctionCall.FunctionParameterType.CONST:
             if GlobalConfig.NO_CONST_INT:
                 commands.append(f"{parameterType} __TDD_tempVar_{tempVarIdx} = ({parameterType}) (__TDD_driver_get_typed_value<{parameterType}>());")
@@ -462,25 +869,44 @@ if __name__ == "__main__":
             commands.append(f"{parameterType} __TDD_tempVar_{tempVarIdx} = ({parameterType}) ({argument.name});")
             args.append(tempVarIdx)
             tempVarIdx += 1
+        elif argument.paramType == FunctionCall.FunctionParameterType.NULL and constraint.get("nonnull", 0):
+            addNonnullArgument(parameterType)
         elif argument.paramType == FunctionCall.FunctionParameterType.NULL:
             commands.append(f"{parameterType} __TDD_tempVar_{tempVarIdx} = ({parameterType}) (nullptr);")
             args.append(tempVarIdx)
             tempVarIdx += 1
         elif argument.paramType == FunctionCall.FunctionParameterType.PTR:
-            commands.append(f"if (!__TDD_driver_get_ptr<{parameterType}>({argument.ptrIndex})) return false;");
-            commands.append(f"{parameterType} __TDD_tempVar_{tempVarIdx} = ({parameterType}) (__TDD_driver_get_typed_object<{parameterType}>({argument.ptrIndex}, {argument.offset}));")
+            pointer = getPointer(parameterType, argument.ptrIndex, argument.offset, constraint)
+            commands.append(f"{parameterType} __TDD_tempVar_{tempVarIdx} = {pointer};")
             args.append(tempVarIdx)
             tempVarIdx += 1
             lastPointerIndex = argument.ptrIndex
+            paramPointerIndex[argument.idx] = argument.ptrIndex
         elif argument.paramType == FunctionCall.FunctionParameterType.PTR_SIZE:
             assert lastPointerIndex != -1
-            commands.append(f"{parameterType} __TDD_tempVar_{tempVarIdx} = ({parameterType}) (__TDD_ptr_size.at({lastPointerIndex}));")
+            commands.append(f"{parameterType} __TDD_tempVar_{tempVarIdx} = ({parameterType}) (__TDD_ptrs.size[{lastPointerIndex}]);")
             args.append(tempVarIdx)
             tempVarIdx += 1
         else:
             assert False, f"Unknown parameter type : {argument.paramType}"
-    def addValueArgument(parameterType : str):
+    def addValueArgument(parameterType : str, constraint : Dict):
         global commands, tempVarIdx, lastPointerIndex
+        if "enumValues" in constraint:
+            addEnumArgument(parameterType, constraint)
+            return
+        elif "sizeOf" in constraint and constraint["sizeOf"] in paramPointerIndex:
+            commands.append(f"{parameterType} __TDD_tempVar_{tempVarIdx} = ({parameterType}) (__TDD_ptrs.size[{paramPointerIndex[constraint['sizeOf']]}]);")
+            args.append(tempVarIdx)
+            tempVarIdx += 1
+            return
+        elif constraint.get("isPath", 0):
+            commands.append(f"{parameterType} __TDD_tempVar_{tempVarIdx} = ({parameterType}) (__TDD_driver_file_name());")
+            args.append(tempVarIdx)
+            tempVarIdx += 1
+            return
+        elif constraint.get("nonnull", 0):
+            addNonnullArgument(parameterType)
+            return
         commands.append(f"{parameterType} __TDD_tempVar_{tempVarIdx} = ({parameterType}) (__TDD_driver_get_typed_value<{parameterType}>());")
         args.append(tempVarIdx)
         tempVarIdx += 1
@@ -489,12 +915,12 @@ if __name__ == "__main__":
         currentArgIdx = 0
         if skipFirst:
             currentArgIdx = 1
-        for idx, parameter in enumerate(functionDecl.parametersType):
+        for idx, (parameter, constraint) in enumerate(zip(functionDecl.parametersType, functionDecl.parametersConstraint)):
             if currentArgIdx < len(arguments) and arguments[currentArgIdx].idx == idx:
-                addArgument(arguments[currentArgIdx], parameter)
+                addArgument(arguments[currentArgIdx], parameter, constraint)
                 currentArgIdx += 1
             else:
-                addValueArgument(parameter)
+                addValueArgument(parameter, constraint)
     def getArgList() -> str:
         global args
         subList = ", ".join(f"__TDD_tempVar_{idx}" for idx in args)
@@ -505,42 +931,71 @@ if __name__ == "__main__":
         tempVarIdx = 0
         lastPointerIndex = -1
         args.clear()
+        paramPointerIndex.clear()
+        writtenPointers.clear()
 
         functionCall = FunctionCall(node)
         functionDecl = decls[functionCall.name]
         generateArguments(functionCall, functionDecl, functionDecl.functionType != FunctionDecl.FunctionDeclType.NORMAL_OR_STATIC)
         if functionDecl.functionType == FunctionDecl.FunctionDeclType.NORMAL_OR_STATIC:
             if functionCall.returnIdx == -1:
-                commands.append(f"{functionCall._name}{getArgList()};")
+                commands.append(f"{functionDecl.callee}{getArgList()};")
             else:
-                commands.append(f"{functionDecl.returnType} __TDD_tempVar_{tempVarIdx} = ({functionDecl.returnType}) {functionCall._name}{getArgList()};")
+                commands.append(f"{functionDecl.returnType} __TDD_tempVar_{tempVarIdx} = ({functionDecl.returnType}) {functionDecl.callee}{getArgList()};")
                 tempVarIdx += 1
         elif functionDecl.functionType == FunctionDecl.FunctionDeclType.CXX_METHOD:
-            commands.append(f"if (!__TDD_driver_get_ptr<{functionDecl.base}*>({functionCall.parameters[0].ptrIndex})) return false;")
-            commands.append(f"{functionDecl.base}* __TDD_tempVar_{tempVarIdx} = ({functionDecl.base}*) (__TDD_driver_get_typed_object<{functionDecl.base}*>({functionCall.parameters[0].ptrIndex}, {functionCall.parameters[0].offset}));")
+            # a const method does not write its object, loads taken through it stay valid
+            receiverConstraint = {"pointeeConst" : 1} if functionDecl.isConstMethod else {}
+            pointer = getPointer(f"{functionDecl.base}*", functionCall.parameters[0].ptrIndex, functionCall.parameters[0].offset, receiverConstraint)
+            commands.append(f"{functionDecl.base}* __TDD_tempVar_{tempVarIdx} = {pointer};")
             if functionCall.returnIdx == -1:
-                commands.append(f"__TDD_tempVar_{tempVarIdx}->{functionCall._name}{getArgList()};")
+                commands.append(f"__TDD_tempVar_{tempVarIdx}->{functionDecl.name}{getArgList()};")
             else:
-                commands.append(f"{functionDecl.returnType} __TDD_tempVar_{tempVarIdx} = ({functionDecl.returnType}) __TDD_tempVar_{tempVarIdx}->{functionCall._name}{getArgList()};")
+                commands.append(f"{functionDecl.returnType} __TDD_tempVar_{tempVarIdx} = ({functionDecl.returnType}) __TDD_tempVar_{tempVarIdx}->{functionDecl.name}{getArgList()};")
                 tempVarIdx += 1
             tempVarIdx += 1
         elif functionDecl.functionType == FunctionDecl.FunctionDeclType.CXX_CONSTRUCTOR:
             assert functionCall.returnIdx == -1
-            commands.append(f"if (!__TDD_driver_get_ptr<{functionDecl.base}*>({functionCall.parameters[0].ptrIndex})) return false;")
-            commands.append(f"{functionDecl.base}* __TDD_tempVar_{tempVarIdx} = ({functionDecl.base}*) (__TDD_driver_get_typed_object<{functionDecl.base}*>({functionCall.parameters[0].ptrIndex}, {functionCall.parameters[0].offset}));")
+            pointer = getPointer(f"{functionDecl.base}*", functionCall.parameters[0].ptrIndex, functionCall.parameters[0].offset, {})
+            commands.append(f"{functionDecl.base}* __TDD_tempVar_{tempVarIdx} = {pointer};")
             commands.append(f"new (__TDD_tempVar_{tempVarIdx}) {functionDecl.base}{getArgList()};")
             tempVarIdx += 1
         else:
             assert False, f"Unknown functionDeclType : {functionDecl.FunctionDeclType}"
+        # a release-like function frees the sources, loading from them again would read freed memory
+        if isReleaseLikeName(functionCall.name):
+            writtenPointers.clear()
+        staleLoads = sorted(set(dst for ptrIndex in writtenPointers for dst in loadedThrough.get(ptrIndex, [])))
+        commands.extend(f"__TDD_ptrs.ptr_{dst} = nullptr;" for dst in staleLoads)
         if functionCall.returnIdx != -1:
             commands.append(f"if (!__TDD_tempVar_{tempVarIdx - 1}) return false;")
-            commands.append(f"__TDD_driver_set_ptr<{functionDecl.returnType}>({functionCall.returnIdx}, __TDD_tempVar_{tempVarIdx - 1});")
-
-        fullCommand = "\n".join(f"        {subCommand}" for subCommand in commands)
-        graphNodes.append(f"    nodes.push_back([&] () -> bool {{\n{fullCommand}\n        return true;\n    }});")
-
-    graphNodesStr = "\n".join(graphNodes)
-    skeleton = skeleton.replace("// @@ NODES @@", graphNodesStr)
-
-    with open(GlobalConfig.CC_FILE, "wt") as f:
-        f.write(skeleton)
\ No newline at end of file
+            commands.append(f"__TDD_driver_set_ptr<{functionDecl.returnType}>(__TDD_ptrs.ptr_{functionCall.returnIdx}, __TDD_tempVar_{tempVarIdx - 1});")
+
+        fullCommand = "\n".join(f"    {subCommand}" for subCommand in commands)
+        linkage = "" if shardFiles else "static "
+        graphNodes.append(f"{linkage}bool __TDD_node_{len(graphNodes) + 1} () {{\n{fullCommand}\n    return true;\n}}\n")
+
+    nodeTable = ["nullptr"] + [f"__TDD_node_{idx}" for idx in range(1, len(graphNodes) + 1)]
+    skeleton = skeleton.replace("/* @@ NODE TABLE @@ */", ", ".join(nodeTable))
+    if not shardFiles:
+        skeleton = skeleton.replace("// @@ NODES @@", "\n".join(graphNodes))
+        writeIfChanged(GlobalConfig.CC_FILE, skeleton)
+    else:
+        # the shared part goes to the precompiled header, the pointers to their own header, the nodes to
+        # the shards and __TDDDriver.cc keeps the graph. unchanged files keep their time, make skips them
+        def splitPart(begin : str, end : str, header : str) -> str:
+            partBegin = skeleton.index(begin)
+            partEnd = skeleton.index(end) + len(end)
+            writeIfChanged(header, skeleton[partBegin : partEnd])
+            return skeleton[: partBegin] + f"#include \"{header}\"\n" + skeleton[partEnd :]
+        skeleton = splitPart(GlobalConfig.SHARED_BEGIN, GlobalConfig.SHARED_END, GlobalConfig.HEADER_FILE)
+        skeleton = splitPart(GlobalConfig.POINTERS_BEGIN, GlobalConfig.POINTERS_END, GlobalConfig.POINTERS_FILE)
+        skeleton = skeleton.replace("// @@ NODES @@", "\n".join(f"bool __TDD_node_{idx} ();" for idx in range(1, len(graphNodes) + 1)))
+        writeIfChanged(GlobalConfig.CC_FILE, skeleton)
+        firstNode = 1
+        for shardFile, shardNodes in zip(shardFiles, splitShards(graphNodes, shardCount)):
+            writeIfChanged(shardFile, f"// TDD driver nodes {firstNode} to {firstNode + len(shardNodes) - 1}, a shard of {GlobalConfig.CC_FILE}\n"
+                                      f"#include \"{GlobalConfig.HEADER_FILE}\"\n#include \"{GlobalConfig.POINTERS_FILE}\"\n\nnamespace TDD {{\n\n"
+                                      + "\n".join(shardNodes) + "\n} // namespace TDD\n")
+            firstNode += len(shardNodes)
+        writeMakefile([GlobalConfig.CC_FILE] + shardFiles)
\ No newline at end of file
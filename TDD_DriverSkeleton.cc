@@ -1,401 +1,473 @@
 /* TDD Driver from OUS
  * Compile Command : // @@ DRIVER COMPILE COMMAND @@
+ * Coverage Compile Command : // @@ COVERAGE COMPILE COMMAND @@
+ * the first builds the driver for fuzzing, the second one for coverage reports and debugging.
  */
 
 #ifndef __TDD_DRIVER
 #define __TDD_DRIVER
 
-#include <cerrno>
-#include <cinttypes>
-#include <cstddef>
-#include <cstring>
-#include <cstdio>
-#include <cstdlib>
-#include <deque>
-#include <fstream>
-#include <functional>
-#include <iostream>
-#include <map>
-#include <random>
-#include <string>
-#include <sys/stat.h>
-#include <unistd.h>
-#include <vector>
-#include <type_traits>
-
-#define __TDD_ERROR_EXIT_CODE 110
-#define __TDD_OBJECT_CREATE_FAIL 120
-#define __TDD_UNEG1 (uint64_t) (-1)
-#define __TDD_DEBUG__ 1
-#if (defined (__TDD_DEBUG__) && __TDD_DEBUG__)
-#define __TDD_ASSERT(cond, msg) \
-    if (!(cond)) { \
-        std::cerr << msg << " !! \n"; \
-        std::cerr << "Error in ==> " << __FILE__ << " :: " << __LINE__ << " \n"; \
-        exit(__TDD_ERROR_EXIT_CODE); \
-    } \
-    void(0)
-#else
-#define __TDD_ASSERT(cond, msg) void(0)
-#endif
-#define __TDD_DRIVER_MIN_SIZE // @@ MIN SIZE @@
-#define __TDD_DRIVER_MAX_SIZE // @@ MAX SIZE @@
-#define __TDD_FLOATING_EPS 1e-9
-#define __TDD_FLOATING_EQUAL(a, b) (-__TDD_FLOATING_EPS <= a - b && a - b <= __TDD_FLOATING_EPS)
-
-// @@ PRE OPERATIONS @@
-
-// @@ OPAQUE TYPES @@
+// @@ SHARED PART @@
 
 namespace TDD {
 
-const uint8_t* __TDD_global_begin  = nullptr;
-const uint8_t* __TDD_global_end    = nullptr;
-const uint8_t* __TDD_global_cursor = nullptr;
-std::default_random_engine __TDD_random_engine;
-std::uniform_real_distribution<double> __TDD_double_distribution = std::uniform_real_distribution<double>(0, 1);
-std::vector<std::function<void ()>> __TDD_funcitons_run_on_exit;
-uint64_t __TDD_file_count = 0;
-std::vector<void*> __TDD_ptr;
-std::vector<uint64_t> __TDD_ptr_size;
-std::map<uint64_t, std::pair<uint64_t, uint64_t>> __TDD_load_ptr;
-
-void __TDD_driver_save_to_file (char* fileName, const void* data, size_t size) {
+extern "C" int LLVMFuzzerTestOneInput (const uint8_t* buffer, size_t size) {
     if (size == 0) {
-        size = strlen((const char*) (data));
+        return 0;
     }
-    FILE* file = fopen(fileName, "w");
-    fwrite(data, size, 1, file);
-    fclose(file);
-}
-
-void __TDD_driver_save_to_file_append (char* fileName, const void* data, size_t size) {
-    if (size == 0) {
-        size = strlen((const char*) (data));
+    __TDD_driver_init(buffer, size);
+    if (__TDD_fork_mode) {
+        __TDD_driver_fork_main();
+    } else {
+        __TDD_driver_main();
     }
-    FILE* file = fopen(fileName, "a");
-    fwrite(data, size, 1, file);
-    fclose(file);
-}
-
-void __TDD_driver_register_free (std::function<void ()> func) {
-    __TDD_funcitons_run_on_exit.emplace_back(func);
+    __TDD_driver_fin();
+    return 0;
 }
 
-uint8_t __TDD_driver_next () {
-    uint8_t ret = *__TDD_global_cursor++;
-    if (__TDD_global_cursor == __TDD_global_end) {
-        __TDD_global_cursor = __TDD_global_begin;
+// only defined when linked with libFuzzer, the mutators below are only called by it
+extern "C" __attribute__ ((weak)) size_t LLVMFuzzerMutate (uint8_t* data, size_t size, size_t maxSize);
+
+#ifndef __TDD_NO_CUSTOM_MUTATOR
+void __TDD_driver_split (const uint8_t* data, uint64_t size, std::vector<uint8_t>& schedule, std::vector<std::vector<uint8_t>>& sections) {
+    TDD_Driver_Layout layout(data, size);
+    schedule.assign(layout.schedule, layout.schedule + layout.scheduleSize);
+    if (!layout.sectioned) {
+        // the mutated input is sectioned
+        sections.emplace_back(layout.sections, layout.sections + layout.sectionsSize);
+        return;
     }
-    return ret;
-}
-
-uint64_t __TDD_driver_integer () {
-    uint64_t ret = 0;
-    for (int _ = 0; _ < 8; ++_) {
-        ret <<= 8;
-        ret |= __TDD_driver_next();
+    const uint8_t* cursor = layout.sections;
+    const uint8_t* section = nullptr;
+    uint64_t sectionSize = 0;
+    while (TDD_Driver_Layout::nextSection(cursor, layout.sections + layout.sectionsSize, section, sectionSize)) {
+        sections.emplace_back(section, section + sectionSize);
     }
-    return ret;
 }
 
-double __TDD_driver_floating () {
-    return __TDD_double_distribution(__TDD_random_engine);
-}
-
-uint64_t __TDD_driver_size () {
-    uint64_t size = __TDD_driver_integer();
-    size %= __TDD_DRIVER_MAX_SIZE - __TDD_DRIVER_MIN_SIZE + 1;
-    size += __TDD_DRIVER_MIN_SIZE;
-    return size;
+void __TDD_driver_mutate_section (std::vector<uint8_t>& section, uint64_t maxSize, unsigned int seed) {
+    if (section.empty()) {
+        section.push_back(seed & 0xFF);
+    }
+    uint64_t size = section.size();
+    section.resize(std::min(std::max(size, maxSize), TDD_Driver_Layout::MAX_SECTION_SIZE));
+    section.resize(LLVMFuzzerMutate(section.data(), std::min(size, section.size()), section.size()));
 }
 
-void* __TDD_driver_alloc (uint64_t size, bool allZero = true) {
-    uint8_t* ret = (uint8_t*) (malloc(size));
-    if (!allZero) {
-        for (uint64_t i = 0; i < size; ++i) {
-            ret[i] = __TDD_driver_next();
+// mutates the schedule or one section, sometimes inserts or drops a section, rarely mutates both,
+// so most mutations keep the node order and the data of the other nodes
+extern "C" size_t LLVMFuzzerCustomMutator (uint8_t* data, size_t size, size_t maxSize, unsigned int seed) {
+    if (maxSize < TDD_Driver_Layout::HEADER_SIZE + 3) {
+        return LLVMFuzzerMutate(data, size, maxSize);
+    }
+    std::vector<uint8_t> schedule;
+    std::vector<std::vector<uint8_t>> sections;
+    __TDD_driver_split(data, size, schedule, sections);
+    auto room = [&] () -> uint64_t {
+        uint64_t used = TDD_Driver_Layout::HEADER_SIZE + schedule.size();
+        for (const std::vector<uint8_t>& section : sections) {
+            used += 2 + section.size();
         }
-    } else {
-        memset(ret, 0, size);
+        return used < maxSize ? maxSize - used : 0;
+    };
+    uint64_t choice = seed % 8;
+    seed >>= 3;
+    if (choice < 2 || choice == 7) {
+        __TDD_driver_mutate_section(schedule, schedule.size() + room(), seed);
     }
-    __TDD_driver_register_free([=] () {free(ret);});
-    return ret;
-}
-
-void* __TDD_driver_string (uint64_t& size) {
-    uint8_t* ret;
-    size = __TDD_driver_size();
-    ret = (uint8_t*) (malloc(size + 1));
-    for (uint64_t i = 0; i < size; ++i) {
-        ret[i] = __TDD_driver_next();
+    if (sections.empty()) {
+        sections.emplace_back();
     }
-    ret[size] = '\0';
-    __TDD_driver_register_free([=] () {free(ret);});
-    return ret;
+    uint64_t sectionIdx = seed % sections.size();
+    if (choice == 6 && (seed & 0x100)) {
+        sections.erase(sections.begin() + sectionIdx);
+    } else if (choice == 6) {
+        sections.insert(sections.begin() + sectionIdx, sections[sectionIdx]);
+    } else if (choice >= 2) {
+        __TDD_driver_mutate_section(sections[sectionIdx], sections[sectionIdx].size() + room(), seed);
+    }
+    return TDD_Driver_Layout::write(data, maxSize, schedule, sections);
 }
 
-template <typename T>
-void* __TDD_driver_typed_alloc (uint64_t& size) {
-    if (std::is_reference_v<T>) {
-        size = sizeof (std::remove_reference_t<T>);
-    } else if (std::is_pointer_v<T>) {
-        size = sizeof (std::remove_pointer_t<T>);
-    } else {
-        __TDD_ASSERT (false, "__TDD_driver_typed_alloc without a reference or pointer type");
+// the schedule of one input with the sections of the other, or the first sections of one with the rest of the other
+extern "C" size_t LLVMFuzzerCustomCrossOver (const uint8_t* data1, size_t size1, const uint8_t* data2, size_t size2, uint8_t* out, size_t maxOutSize, unsigned int seed) {
+    std::vector<uint8_t> schedule1, schedule2;
+    std::vector<std::vector<uint8_t>> sections1, sections2;
+    __TDD_driver_split(data1, size1, schedule1, sections1);
+    __TDD_driver_split(data2, size2, schedule2, sections2);
+    if (seed & 1) {
+        schedule1.swap(schedule2);
+        sections1.swap(sections2);
     }
-    if (size != 1) {
-        return __TDD_driver_alloc(size);
-    } else {
-        return __TDD_driver_string(size);
+    if (seed & 2) {
+        uint64_t sectionIdx = (seed >> 2) % (sections1.size() + 1);
+        sections1.resize(sectionIdx);
+        for (uint64_t idx = sectionIdx; idx < sections2.size(); ++idx) {
+            sections1.push_back(sections2[idx]);
+        }
+        return TDD_Driver_Layout::write(out, maxOutSize, schedule1, sections1);
     }
+    return TDD_Driver_Layout::write(out, maxOutSize, schedule1, sections2);
 }
+#endif
 
-template <>
-void* __TDD_driver_typed_alloc<void*> (uint64_t& size) {
-    return __TDD_driver_string(size);
-}
+// 1 + number of functions reachable from each node's API (see TDD_CallGraph.py)
+const uint64_t __TDD_node_weights[] = {/* @@ NODE WEIGHTS @@ */};
 
-template <>
-void* __TDD_driver_typed_alloc<const void*> (uint64_t& size) {
-    return __TDD_driver_string(size);
-}
+// scheduling graph in CSR form : the successors of node N are
+// __TDD_graph_targets[__TDD_graph_offsets[N]] ... __TDD_graph_targets[__TDD_graph_offsets[N + 1] - 1]
+constexpr uint64_t __TDD_node_count = /* @@ GRAPH NODE COUNT @@ */;
+const uint64_t __TDD_graph_offsets[] = {/* @@ GRAPH OFFSETS @@ */};
+// ends with one unused entry so it is never empty
+const uint64_t __TDD_graph_targets[] = {/* @@ GRAPH TARGETS @@ */};
+const uint64_t __TDD_graph_in_degree[] = {/* @@ GRAPH IN DEGREES @@ */};
 
-template <typename T>
-bool __TDD_driver_get_ptr (uint64_t idx) {
-    if (__TDD_ptr.at(idx)) {
-        return true;
-    }
-    std::vector<std::pair<uint64_t, std::pair<uint64_t, uint64_t>>> loadChain;
-    for (uint64_t dst = idx; __TDD_load_ptr.count(dst); ) {
-        std::pair<uint64_t, uint64_t> srcPair = __TDD_load_ptr.at(dst);
-        uint64_t src = srcPair.first, offset = srcPair.second;
-        loadChain.push_back({dst, {src, offset}});
-        if (__TDD_ptr[src]) {
-            break;
-        } else {
-            dst = src;
-        }
+// nodes reading no input whose results are only read later, in the order they run once, ends with __TDD_UNEG1
+const uint64_t __TDD_setup_nodes[] = {/* @@ SETUP NODES @@ */};
+// release-like nodes only freeing setup results, skipped while those are reused, ends with __TDD_UNEG1
+const uint64_t __TDD_teardown_nodes[] = {/* @@ TEARDOWN NODES @@ */};
+
+struct TDD_Driver_Graph {
+    uint64_t inDegree[__TDD_node_count];
+    uint64_t currentNodes[__TDD_node_count];
+    uint64_t currentCount = 0;
+    // state once node 0 and the setup nodes have run, built on first use
+    uint64_t setupInDegree[__TDD_node_count];
+    uint64_t setupNodes[__TDD_node_count];
+    uint64_t setupCount = __TDD_UNEG1;
+
+    // only the in-degrees are copied per input
+    void reset () {
+        memcpy(inDegree, __TDD_graph_in_degree, sizeof (inDegree));
+        currentNodes[0] = 0;
+        currentCount = 1;
     }
-    if (!loadChain.empty()) {
-        while (!loadChain.empty()) {
-            std::pair<uint64_t, std::pair<uint64_t, uint64_t>> loadPair = loadChain.back();
-            uint64_t dst = loadPair.first, src = loadPair.second.first, offset = loadPair.second.second;
-            loadChain.pop_back();
-            if (!__TDD_ptr[src]) {
-                return false;
-            } else {
-                __TDD_ptr[dst] = *(void**) (((char*) __TDD_ptr[src]) + offset);
-                if (!__TDD_ptr[dst]) {
-                    return false;
+
+    void resetAfterSetup () {
+        if (setupCount == __TDD_UNEG1) {
+            bool done[__TDD_node_count] = {};
+            memcpy(setupInDegree, __TDD_graph_in_degree, sizeof (setupInDegree));
+            for (uint64_t idx = 0, node = 0; node != __TDD_UNEG1; node = __TDD_setup_nodes[idx++]) {
+                done[node] = true;
+                for (uint64_t edgeIdx = __TDD_graph_offsets[node]; edgeIdx < __TDD_graph_offsets[node + 1]; ++edgeIdx) {
+                    --setupInDegree[__TDD_graph_targets[edgeIdx]];
+                }
+            }
+            setupCount = 0;
+            for (uint64_t node = 0; node < __TDD_node_count; ++node) {
+                if (!done[node] && setupInDegree[node] == 0) {
+                    setupNodes[setupCount++] = node;
                 }
             }
         }
-        return true;
-    } else {
-        void*& ptr = __TDD_ptr.at(idx);
-        uint64_t& size = __TDD_ptr_size.at(idx);
-        ptr = __TDD_driver_typed_alloc<T>(size);
-        return true;
+        memcpy(inDegree, setupInDegree, sizeof (inDegree));
+        memcpy(currentNodes, setupNodes, setupCount * sizeof (uint64_t));
+        currentCount = setupCount;
     }
-}
-
-template <typename T>
-T __TDD_driver_get_typed_object (uint64_t idx, int64_t offset) {
-    if (std::is_reference_v<T>) {
-        return *(std::add_pointer_t<std::remove_reference_t<T>>) (((char*) __TDD_ptr.at(idx)) + offset);
-    } else if (std::is_pointer_v<T>) {
-        return (T) (((char*) __TDD_ptr.at(idx)) + offset);
-    } else {
-        __TDD_ASSERT (false, "__TDD_driver_get_typed_object without a reference or pointer type");
-    }
-}
-
-template <>
-void* __TDD_driver_get_typed_object<void*> (uint64_t idx, int64_t offset) {
-    return (void*) (((char*) __TDD_ptr.at(idx)) + offset);
-}
-
-template <>
-const void* __TDD_driver_get_typed_object<const void*> (uint64_t idx, int64_t offset) {
-    return (void*) (((char*) __TDD_ptr.at(idx)) + offset);
-}
 
-template <typename T>
-T __TDD_driver_get_typed_value () {
-    if (std::is_integral_v<T>) {
-        return (T) (__TDD_driver_integer());
-    } else if (std::is_floating_point_v<T>) {
-        return (T) (__TDD_driver_floating());
-    } else {
-        return {};
+    uint64_t getNext () {
+        if (currentCount == 0) {
+            return __TDD_UNEG1;
+        }
+        uint64_t totalWeight = 0;
+        for (uint64_t idx = 0; idx < currentCount; ++idx) {
+            totalWeight += __TDD_node_weights[currentNodes[idx]];
+        }
+        // no schedule byte is spent without a choice
+        uint64_t selectedWeight = currentCount == 1 ? 0 : __TDD_driver_schedule(totalWeight), selectedIdx = 0;
+        while (selectedWeight >= __TDD_node_weights[currentNodes[selectedIdx]]) {
+            selectedWeight -= __TDD_node_weights[currentNodes[selectedIdx]];
+            ++selectedIdx;
+        }
+        __TDD_swap(currentNodes[selectedIdx], currentNodes[currentCount - 1]);
+        uint64_t ret = currentNodes[--currentCount];
+        for (uint64_t edgeIdx = __TDD_graph_offsets[ret]; edgeIdx < __TDD_graph_offsets[ret + 1]; ++edgeIdx) {
+            uint64_t toIdx = __TDD_graph_targets[edgeIdx];
+            if (--inDegree[toIdx] == 0) {
+                currentNodes[currentCount++] = toIdx;
+            }
+        }
+        return ret;
     }
-}
+};
 
-template <typename T>
-void __TDD_driver_set_ptr (uint64_t idx, T value) {
-    __TDD_ASSERT (!__TDD_ptr.at(idx), "set on existing ptr");
-    if (std::is_same_v<T, void*> || std::is_same_v<T, const void*>) {
-        __TDD_ptr.at(idx) = (void*) (value);
-    } else if (std::is_reference_v<T>) {
-        __TDD_ptr.at(idx) = (void*) (&value);
-    } else if (std::is_pointer_v<T>) {
-        __TDD_ptr.at(idx) = (void*) (value);
-    } else {
-        __TDD_ASSERT (false, "__TDD_driver_set_ptr without a reference or pointer type");
-    }
-}
+TDD_Driver_Graph __TDD_graph;
 
-template <>
-void __TDD_driver_set_ptr<void*> (uint64_t idx, void* value) {
-    __TDD_ASSERT (!__TDD_ptr.at(idx), "set on existing ptr");
-    __TDD_ptr.at(idx) = (void*) (value);
-}
+TDD_Driver_Stats __TDD_stats(__TDD_node_count);
 
-template <>
-void __TDD_driver_set_ptr<const void*> (uint64_t idx, const void* value) {
-    __TDD_ASSERT (!__TDD_ptr.at(idx), "set on existing ptr");
-    __TDD_ptr.at(idx) = const_cast<void*>((const void*) (value));
-}
+// Nodes
+// @@ NODES @@
 
-void* __TDD_driver_file_name () {
-    std::string realFileName = "__TDD_file_" + std::to_string(__TDD_file_count++);
-    remove(realFileName.c_str());
-    FILE* file = fopen(realFileName.c_str(), "w");
-    uint64_t size = __TDD_driver_size();
-    uint8_t* tmp = (uint8_t*) (malloc(size));
-    for (uint64_t i = 0; i < size; ++i) {
-        tmp[i] = __TDD_driver_next();
-    }
-    fwrite(tmp, size, 1, file);
-    free(tmp);
-    fclose(file);
-    void* ret = malloc(realFileName.size() + 1);
-    __TDD_driver_register_free([=] () {free(ret);});
-    memcpy(ret, realFileName.c_str(), realFileName.size());
-    ((char*) (ret))[realFileName.size()] = '\0';
-    return ret;
-}
+// node 0 is the graph root and never runs
+constexpr bool (* __TDD_nodes[]) () = {/* @@ NODE TABLE @@ */};
 
-std::string __TDD_driver_std_string () {
-    std::string ret;
-    uint64_t size = __TDD_driver_size();
-    ret.resize(size);
-    for (uint64_t i = 0; i < size; ++i) {
-        ret[i] = __TDD_driver_next();
+bool __TDD_driver_run_node (uint64_t idx) {
+    if (!__TDD_trace.file && !__TDD_stats.nodes) {
+        return __TDD_nodes[idx]();
+    }
+    if (__TDD_trace.file) {
+        __TDD_trace.begin(idx);
+    }
+    if (__TDD_stats.nodes) {
+        __TDD_stats.begin(idx);
+    }
+    bool ret = __TDD_nodes[idx]();
+    if (__TDD_stats.nodes) {
+        __TDD_stats.end(idx, ret);
+    }
+    if (__TDD_trace.file) {
+        __TDD_trace.end(idx, ret);
     }
     return ret;
 }
 
-FILE* __TDD_driver_FILEptr () {
-    char* fileName = (char*) (__TDD_driver_file_name());
-    FILE* ret = fopen(fileName, "r+");
-    fseek(ret, 0, SEEK_SET);
-    __TDD_driver_register_free([=] () {fclose(ret);});
-    return ret;
-}
+// the setup nodes run once into their own arena and exit functions, their pointers are
+// copied back into __TDD_ptrs for every input. buffers the driver allocated for them are
+// compared with their contents after setup before each reuse, and setup runs again if
+// an input changed one. reading input or failing turns the reuse off for the whole run.
+// the teardown nodes freeing setup results are skipped while they are reused and run on release.
+struct TDD_Driver_Setup {
+    enum SetupState {SETUP_NOT_RUN, SETUP_VALID, SETUP_DISABLED};
+    SetupState state = __TDD_setup_nodes[0] == __TDD_UNEG1 ? SETUP_DISABLED : SETUP_NOT_RUN;
+    TDD_Driver_Pointers ptr;
+    std::vector<std::pair<uint64_t, std::vector<uint8_t>>> contents;
+    std::vector<std::function<void ()>> runOnExit;
+    TDD_Driver_Arena arena;
+
+    bool run () {
+        __TDD_ptrs = TDD_Driver_Pointers();
+        arena.swap(__TDD_arena);
+        runOnExit.swap(__TDD_funcitons_run_on_exit);
+        uint64_t read = __TDD_global_read;
+        bool succeed = true;
+        for (uint64_t idx = 0; succeed && __TDD_setup_nodes[idx] != __TDD_UNEG1; ++idx) {
+            succeed = __TDD_driver_run_node(__TDD_setup_nodes[idx]);
+        }
+        succeed = succeed && read == __TDD_global_read;
+        arena.swap(__TDD_arena);
+        runOnExit.swap(__TDD_funcitons_run_on_exit);
+        ptr = __TDD_ptrs;
+        if (!succeed) {
+            release(false);
+            __TDD_global_cursor = __TDD_global_begin;
+            return false;
+        }
+        for (uint64_t idx = 0; idx < __TDD_pointer_count; ++idx) {
+            const uint8_t* data = (const uint8_t*) (__TDD_driver_ptr_value(ptr, idx));
+            if (data && ptr.size[idx]) {
+                contents.emplace_back(idx, std::vector<uint8_t>(data, data + ptr.size[idx]));
+            }
+        }
+        return true;
+    }
 
-void __TDD_swap (uint64_t& a, uint64_t& b) {
-    if (&a != &b) {
-        a ^= b;
-        b ^= a;
-        a ^= b;
+    bool valid () const {
+        for (const auto& [idx, data] : contents) {
+            if (memcmp(__TDD_driver_ptr_value(ptr, idx), data.data(), data.size()) != 0) {
+                return false;
+            }
+        }
+        return true;
     }
-}
 
-struct TDD_Driver_Graph {
-    std::vector<uint64_t> head, to, next, inDegree, currentNodes;
-    uint64_t edgeCount, nodeCount;
+    static bool isTeardown (uint64_t node) {
+        for (uint64_t idx = 0; __TDD_teardown_nodes[idx] != __TDD_UNEG1; ++idx) {
+            if (__TDD_teardown_nodes[idx] == node) {
+                return true;
+            }
+        }
+        return false;
+    }
 
-    TDD_Driver_Graph (uint64_t nodeCount_) : head(nodeCount_, __TDD_UNEG1), inDegree(nodeCount_, 0), currentNodes(1, 0), edgeCount(0), nodeCount(nodeCount_) {}
-    void addEdge (uint64_t fromIdx, uint64_t toIdx) {
-        to.push_back(toIdx);
-        next.push_back(head.at(fromIdx));
-        inDegree.at(toIdx)++;
-        head.at(fromIdx) = edgeCount++;
+    // the teardown nodes and exit functions registered by setup nodes see their pointers
+    void release (bool teardown) {
+        __TDD_ptrs = ptr;
+        for (uint64_t idx = 0; teardown && __TDD_teardown_nodes[idx] != __TDD_UNEG1; ++idx) {
+            __TDD_nodes[__TDD_teardown_nodes[idx]]();
+        }
+        while (!runOnExit.empty()) {
+            auto func = runOnExit.back();
+            func();
+            runOnExit.pop_back();
+        }
+        arena.reset();
+        ptr = TDD_Driver_Pointers();
+        contents.clear();
+        __TDD_ptrs = TDD_Driver_Pointers();
     }
 
-    uint64_t getNext () {
-        if (currentNodes.empty()) {
-            return __TDD_UNEG1;
+    // true if __TDD_ptrs holds the setup results
+    bool restore () {
+        if (state == SETUP_VALID && !valid()) {
+            release(true);
+            state = SETUP_NOT_RUN;
         }
-        uint64_t selectedIdx = __TDD_driver_integer() % currentNodes.size();
-        __TDD_swap(currentNodes.at(selectedIdx), currentNodes.back());
-        uint64_t ret = currentNodes.back();
-        currentNodes.pop_back();
-        for (uint64_t edgeIdx = head.at(ret); edgeIdx != __TDD_UNEG1; edgeIdx = next.at(edgeIdx)) {
-            uint64_t toIdx = to.at(edgeIdx);
-            if (--inDegree.at(toIdx) == 0) {
-                currentNodes.push_back(toIdx);
-            }
+        if (state == SETUP_NOT_RUN) {
+            state = run() ? SETUP_VALID : SETUP_DISABLED;
         }
-        return ret;
+        if (state != SETUP_VALID) {
+            return false;
+        }
+        __TDD_ptrs = ptr;
+        return true;
     }
-};
 
-void __TDD_driver_init (const uint8_t* buffer, size_t size) {
-    __TDD_global_begin  = buffer;
-    __TDD_global_end    = buffer + size;
-    __TDD_global_cursor = buffer;
-    __TDD_file_count = 0;
-    __TDD_random_engine.seed(__TDD_driver_integer());
-    __TDD_funcitons_run_on_exit.clear();
-    __TDD_ptr.clear();
-    __TDD_ptr_size.clear();
-    __TDD_load_ptr.clear();
-}
+    ~TDD_Driver_Setup () {
+        if (state == SETUP_VALID) {
+            release(true);
+        }
+    }
+};
 
-int __TDD_driver_main ();
+TDD_Driver_Setup __TDD_setup;
 
-void __TDD_driver_fin () {
-    while (!__TDD_funcitons_run_on_exit.empty()) {
-        auto func = __TDD_funcitons_run_on_exit.back();
-        func();
-        __TDD_funcitons_run_on_exit.pop_back();
+int __TDD_driver_main () {
+    // Pointers and Graph
+    bool reused = __TDD_setup.restore();
+    if (reused) {
+        __TDD_graph.resetAfterSetup();
+    } else {
+        __TDD_ptrs = TDD_Driver_Pointers();
+        __TDD_graph.reset();
     }
-    __TDD_global_begin  = nullptr;
-    __TDD_global_end    = nullptr;
-    __TDD_global_cursor = nullptr;
-}
 
-extern "C" int LLVMFuzzerTestOneInput (const uint8_t* buffer, size_t size) {
-    if (size == 0) {
-        return 0;
+    for (uint64_t idx = __TDD_graph.getNext(); idx != __TDD_UNEG1; idx = __TDD_graph.getNext()) {
+        if (idx != 0 && !(reused && TDD_Driver_Setup::isTeardown(idx))) {
+            __TDD_driver_next_section();
+            if (!__TDD_driver_run_node(idx)) {
+                break;
+            }
+        }
     }
-    __TDD_driver_init(buffer, size);
-    __TDD_driver_main();
-    __TDD_driver_fin();
+
     return 0;
 }
 
-int __TDD_driver_main () {
-    // Pointers
-    __TDD_ptr.resize(/* @@ POINTER COUNT @@ */, nullptr);
-    __TDD_ptr_size.resize(/* @@ POINTER COUNT @@ */, 0);
+} // namespace TDD
 
-    // Loads
-// @@ PTR LOADS @@
+// inline 8-bit counters of -fsanitize=fuzzer in this binary, both null without them
+extern "C" __attribute__ ((weak)) uint8_t __start___sancov_cntrs[];
+extern "C" __attribute__ ((weak)) uint8_t __stop___sancov_cntrs[];
+// only defined with LeakSanitizer, non zero if it reported leaks
+extern "C" __attribute__ ((weak)) int __lsan_do_recoverable_leak_check ();
 
-    // Graph
-    TDD_Driver_Graph __TDD_graph(/* @@ GRAPH NODE COUNT @@ */);
-// @@ GRAPH EDGES @@
+namespace TDD {
 
-    // Nodes
-    std::vector<std::function<bool ()>> nodes;
-    nodes.push_back([&] () -> bool {
-        __TDD_ASSERT (false, "Node 0 should never be executed");
-    });
+#ifdef __linux__
+// the __sancov_cntrs section of a loaded module, read from its section headers on disk :
+// the __start / __stop symbols of a shared library are hidden from the executable
+int __TDD_driver_module_counters (struct dl_phdr_info* info, size_t, void* data) {
+    auto& ranges = *(std::vector<std::pair<uint8_t*, uint64_t>>*) (data);
+    const char* path = info->dlpi_name && info->dlpi_name[0] ? info->dlpi_name : "/proc/self/exe";
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return 0;
+    }
+    struct stat st;
+    void* file = fstat(fd, &st) == 0 && (uint64_t) (st.st_size) >= sizeof (ElfW(Ehdr)) ? mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (file == MAP_FAILED) {
+        return 0;
+    }
+    const uint8_t* begin = (const uint8_t*) (file);
+    const ElfW(Ehdr)* header = (const ElfW(Ehdr)*) (file);
+    uint64_t sectionsEnd = header->e_shoff + (uint64_t) (header->e_shnum) * sizeof (ElfW(Shdr));
+    if (memcmp(header->e_ident, ELFMAG, SELFMAG) == 0 && header->e_shentsize == sizeof (ElfW(Shdr)) &&
+        header->e_shstrndx < header->e_shnum && sectionsEnd <= (uint64_t) (st.st_size)) {
+        const ElfW(Shdr)* sections = (const ElfW(Shdr)*) (begin + header->e_shoff);
+        const ElfW(Shdr)& names = sections[header->e_shstrndx];
+        for (uint64_t idx = 0; idx < header->e_shnum; ++idx) {
+            const ElfW(Shdr)& section = sections[idx];
+            if (names.sh_offset + section.sh_name + sizeof ("__sancov_cntrs") <= (uint64_t) (st.st_size) &&
+                strcmp((const char*) (begin + names.sh_offset + section.sh_name), "__sancov_cntrs") == 0 && section.sh_size) {
+                ranges.emplace_back((uint8_t*) (info->dlpi_addr + section.sh_addr), section.sh_size);
+            }
+        }
+    }
+    munmap(file, st.st_size);
+    return 0;
+}
+#endif
 
-// @@ NODES @@
+// a page shared with the forked children : whether __TDD_driver_main returned, then the counters
+// of every module loaded when fork mode starts, the executable and the target libraries
+struct TDD_Driver_Fork {
+    uint64_t* finished = nullptr;
+    uint8_t* counters = nullptr;
+    uint64_t counterSize = 0;
+    std::vector<std::pair<uint8_t*, uint64_t>> ranges;
+
+    void map () {
+#ifdef __linux__
+        dl_iterate_phdr(__TDD_driver_module_counters, &ranges);
+#else
+        if (__stop___sancov_cntrs != __start___sancov_cntrs) {
+            ranges.emplace_back(__start___sancov_cntrs, __stop___sancov_cntrs - __start___sancov_cntrs);
+        }
+#endif
+        for (const auto& [begin, size] : ranges) {
+            counterSize += size;
+        }
+        __TDD_ASSERT (counterSize != 0, "fork mode found no -fsanitize=fuzzer counters, libFuzzer would see no coverage : "
+                                        "instrument the target, or link it statically on systems without dl_iterate_phdr");
+        void* shm = mmap(nullptr, sizeof (uint64_t) + counterSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        __TDD_ASSERT (shm != MAP_FAILED, "can NOT map the results of the forked children");
+        finished = (uint64_t*) (shm);
+        counters = (uint8_t*) (finished + 1);
+    }
 
-    for (uint64_t idx = __TDD_graph.getNext(); idx != __TDD_UNEG1; idx = __TDD_graph.getNext()) {
-        if (idx != 0) {
-            if (!nodes.at(idx)()) {
-                break;
+    // child to shared page, or shared page back to the parent
+    void copy (bool toShared) {
+        uint8_t* cursor = counters;
+        for (const auto& [begin, size] : ranges) {
+            if (toShared) {
+                memcpy(cursor, begin, size);
+            } else {
+                memcpy(begin, cursor, size);
             }
+            cursor += size;
         }
     }
+};
 
+TDD_Driver_Fork __TDD_fork;
+
+// the setup nodes run in the parent, the child inherits their state and runs the input on a
+// copy-on-write snapshot, so nothing it leaks or breaks reaches the next input. the parent only
+// gets the 8-bit counters of libFuzzer back : comparison and value profile feedback and the
+// -fprofile-instr-generate counters stay in the child, use the in-process mode for those and
+// for coverage reports. the child checks for leaks itself, LeakSanitizer never runs at _exit.
+// a child that does not finish ends the parent the same way, so libFuzzer still saves the input.
+int __TDD_driver_fork_main () {
+    if (!__TDD_fork.finished) {
+        __TDD_fork.map();
+    }
+    __TDD_setup.restore();
+    *__TDD_fork.finished = 0;
+    pid_t pid = fork();
+    __TDD_ASSERT (pid >= 0, "can NOT fork : " << strerror(errno));
+    if (pid == 0) {
+#ifdef __linux__
+        // do not outlive a parent killed by a timeout
+        prctl(PR_SET_PDEATHSIG, SIGKILL);
+#endif
+        __TDD_driver_main();
+        if (__lsan_do_recoverable_leak_check && __lsan_do_recoverable_leak_check()) {
+            _exit(__TDD_ERROR_EXIT_CODE);
+        }
+        __TDD_fork.copy(true);
+        *__TDD_fork.finished = 1;
+        _exit(0);
+    }
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+    if (!*__TDD_fork.finished) {
+        if (WIFSIGNALED(status)) {
+            raise(WTERMSIG(status));
+        }
+        exit(WIFEXITED(status) && WEXITSTATUS(status) ? WEXITSTATUS(status) : __TDD_ERROR_EXIT_CODE);
+    }
+    __TDD_fork.copy(false);
     return 0;
 }
 
@@ -0,0 +1,734 @@
+// TDD driver, the part shared by __TDDDriver.cc and its node shards, see TDD_DriverSkeleton.cc.
+// everything defined here is inline : it is included once per translation unit of a sharded driver.
+// nothing in it depends on the calling chain, a sharded driver precompiles it once per configuration.
+
+#ifndef __TDD_DRIVER_SHARED
+#define __TDD_DRIVER_SHARED
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cinttypes>
+#include <csignal>
+#include <cstddef>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <fcntl.h>
+#include <fstream>
+#include <functional>
+#include <initializer_list>
+#include <iostream>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+#include <type_traits>
+#ifdef __linux__
+#include <elf.h>
+#include <link.h>
+#include <sys/prctl.h>
+#endif
+
+#define __TDD_ERROR_EXIT_CODE 110
+#define __TDD_OBJECT_CREATE_FAIL 120
+#define __TDD_UNEG1 (uint64_t) (-1)
+#define __TDD_DEBUG__ 1
+#if (defined (__TDD_DEBUG__) && __TDD_DEBUG__)
+#define __TDD_ASSERT(cond, msg) \
+    if (!(cond)) { \
+        std::cerr << msg << " !! \n"; \
+        std::cerr << "Error in ==> " << __FILE__ << " :: " << __LINE__ << " \n"; \
+        exit(__TDD_ERROR_EXIT_CODE); \
+    } \
+    void(0)
+#else
+#define __TDD_ASSERT(cond, msg) void(0)
+#endif
+#define __TDD_DRIVER_MIN_SIZE // @@ MIN SIZE @@
+#define __TDD_DRIVER_MAX_SIZE // @@ MAX SIZE @@
+#if defined (__SANITIZE_ADDRESS__)
+#define __TDD_ASAN 1
+#elif defined (__has_feature)
+#if __has_feature(address_sanitizer)
+#define __TDD_ASAN 1
+#endif
+#endif
+#if defined (__TDD_ASAN)
+#include <sanitizer/asan_interface.h>
+#define __TDD_POISON(addr, size) ASAN_POISON_MEMORY_REGION(addr, size)
+#define __TDD_UNPOISON(addr, size) ASAN_UNPOISON_MEMORY_REGION(addr, size)
+#else
+#define __TDD_POISON(addr, size) void(0)
+#define __TDD_UNPOISON(addr, size) void(0)
+#endif
+#define __TDD_FLOATING_EPS 1e-9
+#define __TDD_FLOATING_EQUAL(a, b) (-__TDD_FLOATING_EPS <= a - b && a - b <= __TDD_FLOATING_EPS)
+
+// @@ PRE OPERATIONS @@
+
+// @@ OPAQUE TYPES @@
+
+namespace TDD {
+
+inline const uint8_t* __TDD_global_begin  = nullptr;
+inline const uint8_t* __TDD_global_end    = nullptr;
+inline const uint8_t* __TDD_global_cursor = nullptr;
+inline const uint8_t* __TDD_schedule_end    = nullptr;
+inline const uint8_t* __TDD_schedule_cursor = nullptr;
+// bytes read from all inputs so far
+inline uint64_t __TDD_global_read = 0;
+inline std::vector<std::function<void ()>> __TDD_funcitons_run_on_exit;
+inline uint64_t __TDD_file_count = 0;
+// a pointer id used as T is stored as T, references as pointers
+template <typename T>
+using __TDD_storage_t = std::conditional_t<std::is_reference_v<T>, std::add_pointer_t<std::remove_reference_t<T>>, T>;
+
+inline void __TDD_driver_save_to_file (char* fileName, const void* data, size_t size) {
+    if (size == 0) {
+        size = strlen((const char*) (data));
+    }
+    FILE* file = fopen(fileName, "w");
+    fwrite(data, size, 1, file);
+    fclose(file);
+}
+
+inline void __TDD_driver_save_to_file_append (char* fileName, const void* data, size_t size) {
+    if (size == 0) {
+        size = strlen((const char*) (data));
+    }
+    FILE* file = fopen(fileName, "a");
+    fwrite(data, size, 1, file);
+    fclose(file);
+}
+
+inline void __TDD_driver_register_free (std::function<void ()> func) {
+    __TDD_funcitons_run_on_exit.emplace_back(func);
+}
+
+// bump allocator for the buffers one execution hands out, reset at once in __TDD_driver_fin.
+// every object is preceded by a poisoned redzone, so ASan still reports overflows between them.
+struct TDD_Driver_Arena {
+    static constexpr uint64_t BLOCK_SIZE = 1 << 20;
+    static constexpr uint64_t REDZONE    = 32;
+    std::vector<uint8_t*> blocks;
+    std::vector<void*> largeObjects;
+    uint64_t blockIdx = 0, used = 0;
+
+    void* alloc (uint64_t size) {
+        uint64_t need = REDZONE + ((size + 15) & ~(uint64_t) (15));
+        if (need > BLOCK_SIZE / 4) {
+            // large objects keep the redzones of malloc
+            largeObjects.push_back(malloc(size));
+            return largeObjects.back();
+        }
+        if (blockIdx < blocks.size() && used + need > BLOCK_SIZE) {
+            ++blockIdx;
+            used = 0;
+        }
+        if (blockIdx == blocks.size()) {
+            blocks.push_back((uint8_t*) (malloc(BLOCK_SIZE)));
+            __TDD_POISON(blocks.back(), BLOCK_SIZE);
+        }
+        uint8_t* ret = blocks[blockIdx] + used + REDZONE;
+        used += need;
+        __TDD_UNPOISON(ret, size);
+        return ret;
+    }
+
+    void swap (TDD_Driver_Arena& other) {
+        blocks.swap(other.blocks);
+        largeObjects.swap(other.largeObjects);
+        std::swap(blockIdx, other.blockIdx);
+        std::swap(used, other.used);
+    }
+
+    void reset () {
+        for (uint64_t idx = 0; idx < blocks.size() && idx <= blockIdx; ++idx) {
+            __TDD_POISON(blocks[idx], BLOCK_SIZE);
+        }
+        for (void* object : largeObjects) {
+            free(object);
+        }
+        largeObjects.clear();
+        blockIdx = 0;
+        used = 0;
+    }
+
+    ~TDD_Driver_Arena () {
+        reset();
+        for (uint8_t* block : blocks) {
+            __TDD_UNPOISON(block, BLOCK_SIZE);
+            free(block);
+        }
+    }
+};
+
+inline TDD_Driver_Arena __TDD_arena;
+
+// driver input, version 1 :
+//   1 byte     version
+//   2 bytes    schedule size S, little-endian
+//   S bytes    schedule, 4 little-endian bytes per choice among the ready nodes
+//   sections   a 2-byte little-endian size and as many bytes, the k-th one read by the k-th scheduled node
+// nothing is read twice : an exhausted schedule chooses the first ready node and an exhausted section
+// reads zeros. an input starting with another byte is a single stream the schedule and all nodes read
+// in turn, without wrapping around either.
+struct TDD_Driver_Layout {
+    static constexpr uint8_t VERSION = 1;
+    static constexpr uint64_t HEADER_SIZE = 3;
+    static constexpr uint64_t MAX_SECTION_SIZE = 0xFFFF;
+    bool sectioned = false;
+    const uint8_t* schedule = nullptr;
+    uint64_t scheduleSize = 0;
+    // length-prefixed sections, or the whole input if it is not sectioned
+    const uint8_t* sections = nullptr;
+    uint64_t sectionsSize = 0;
+
+    TDD_Driver_Layout (const uint8_t* data, uint64_t size) {
+        if (size >= HEADER_SIZE && data[0] == VERSION) {
+            sectioned = true;
+            scheduleSize = std::min<uint64_t>(data[1] | (uint64_t) (data[2]) << 8, size - HEADER_SIZE);
+            schedule = data + HEADER_SIZE;
+            sections = schedule + scheduleSize;
+            sectionsSize = size - HEADER_SIZE - scheduleSize;
+        } else {
+            sections = data;
+            sectionsSize = size;
+        }
+    }
+
+    // the section at data, a size cut to what is left, false at the end
+    static bool nextSection (const uint8_t*& data, const uint8_t* end, const uint8_t*& section, uint64_t& sectionSize) {
+        if (end - data < 2) {
+            return false;
+        }
+        sectionSize = std::min<uint64_t>(data[0] | (uint64_t) (data[1]) << 8, end - data - 2);
+        section = data + 2;
+        data = section + sectionSize;
+        return true;
+    }
+
+    // the size written to out, what does not fit in maxSize is cut
+    static uint64_t write (uint8_t* out, uint64_t maxSize, const std::vector<uint8_t>& schedule, const std::vector<std::vector<uint8_t>>& sections) {
+        if (maxSize < HEADER_SIZE) {
+            return 0;
+        }
+        uint64_t scheduleSize = std::min({(uint64_t) (schedule.size()), MAX_SECTION_SIZE, maxSize - HEADER_SIZE});
+        out[0] = VERSION;
+        out[1] = scheduleSize & 0xFF;
+        out[2] = scheduleSize >> 8;
+        if (scheduleSize) {
+            memcpy(out + HEADER_SIZE, schedule.data(), scheduleSize);
+        }
+        uint64_t ret = HEADER_SIZE + scheduleSize;
+        for (const std::vector<uint8_t>& section : sections) {
+            if (maxSize - ret < 2) {
+                break;
+            }
+            uint64_t sectionSize = std::min({(uint64_t) (section.size()), MAX_SECTION_SIZE, maxSize - ret - 2});
+            out[ret] = sectionSize & 0xFF;
+            out[ret + 1] = sectionSize >> 8;
+            if (sectionSize) {
+                memcpy(out + ret + 2, section.data(), sectionSize);
+            }
+            ret += 2 + sectionSize;
+        }
+        return ret;
+    }
+};
+
+inline bool __TDD_sectioned = false;
+// the length prefix of the next section
+inline const uint8_t* __TDD_sections_cursor = nullptr;
+inline const uint8_t* __TDD_sections_end    = nullptr;
+// index of the section being read, __TDD_UNEG1 before the first one
+inline uint64_t __TDD_section_idx = __TDD_UNEG1;
+
+// the next scheduled node reads the next section, an unsectioned input keeps its single stream
+inline void __TDD_driver_next_section () {
+    if (!__TDD_sectioned) {
+        return;
+    }
+    ++__TDD_section_idx;
+    uint64_t size = 0;
+    const uint8_t* section = __TDD_sections_end;
+    TDD_Driver_Layout::nextSection(__TDD_sections_cursor, __TDD_sections_end, section, size);
+    __TDD_global_begin  = section;
+    __TDD_global_end    = section + size;
+    __TDD_global_cursor = section;
+}
+
+// copy the next size bytes of the current section, zeros once it is exhausted
+inline void __TDD_driver_read (void* data, uint64_t size) {
+    uint8_t* dst = (uint8_t*) (data);
+    __TDD_global_read += size;
+    uint64_t chunk = std::min<uint64_t>(size, __TDD_global_end - __TDD_global_cursor);
+    if (chunk) {
+        memcpy(dst, __TDD_global_cursor, chunk);
+        __TDD_global_cursor += chunk;
+    }
+    if (chunk < size) {
+        memset(dst + chunk, 0, size - chunk);
+    }
+}
+
+// a value in [0, total) from the next 4 schedule bytes, little-endian like the sizes of the layout,
+// 0 once the schedule is exhausted. 4 bytes keep every node reachable whatever the total weight of the ready ones
+inline uint64_t __TDD_driver_schedule (uint64_t total) {
+    uint8_t bytes[4] = {0, 0, 0, 0};
+    if (!__TDD_sectioned) {
+        __TDD_driver_read(bytes, sizeof (bytes));
+    } else if (__TDD_schedule_end - __TDD_schedule_cursor >= 4) {
+        memcpy(bytes, __TDD_schedule_cursor, sizeof (bytes));
+        __TDD_schedule_cursor += sizeof (bytes);
+    } else {
+        __TDD_schedule_cursor = __TDD_schedule_end;
+    }
+    uint64_t value = bytes[0] | (uint64_t) (bytes[1]) << 8 | (uint64_t) (bytes[2]) << 16 | (uint64_t) (bytes[3]) << 24;
+    return (uint64_t) ((unsigned __int128) (value) * total >> 32);
+}
+
+// where a node of a trace started reading, see TDD_Reproducer.py
+inline void __TDD_driver_seek (uint64_t sectionIdx, uint64_t offset) {
+    while (__TDD_sectioned && sectionIdx != __TDD_UNEG1 && __TDD_section_idx + 1 <= sectionIdx) {
+        __TDD_driver_next_section();
+    }
+    __TDD_global_cursor = std::min(__TDD_global_begin + offset, __TDD_global_end);
+}
+
+// TDD_DRIVER_TRACE=<file> logs the nodes an input runs, one record per line, the file keeps the last input.
+// TDD_Reproducer.py turns it into a straight-line program.
+//   input <size>
+//   node <id> <section> <offset>   before the node runs, the section is -1 before the first one
+//   end <id> <bytes read>          the node returned true
+//   fail <id> <bytes read>         the node returned false
+//   null <pointer id>              a pointer loader read a null pointer
+struct TDD_Driver_Trace {
+    FILE* file = nullptr;
+    uint64_t read = 0;
+
+    TDD_Driver_Trace () {
+        const char* fileName = getenv("TDD_DRIVER_TRACE");
+        if (fileName && fileName[0]) {
+            file = fopen(fileName, "w");
+            __TDD_ASSERT (file, "can NOT open " << fileName);
+        }
+    }
+
+    // every record is flushed, the last one shows where a crash happened
+    void input (uint64_t size) {
+        rewind(file);
+        if (ftruncate(fileno(file), 0) != 0) {
+            __TDD_ASSERT (false, "can NOT truncate the trace");
+        }
+        fprintf(file, "input %" PRIu64 "\n", size);
+        fflush(file);
+    }
+
+    void begin (uint64_t node) {
+        read = __TDD_global_read;
+        fprintf(file, "node %" PRIu64 " %" PRId64 " %" PRIu64 "\n", node, (int64_t) (__TDD_section_idx), (uint64_t) (__TDD_global_cursor - __TDD_global_begin));
+        fflush(file);
+    }
+
+    void end (uint64_t node, bool succeed) {
+        fprintf(file, "%s %" PRIu64 " %" PRIu64 "\n", succeed ? "end" : "fail", node, __TDD_global_read - read);
+        fflush(file);
+    }
+
+    void null (uint64_t idx) {
+        fprintf(file, "null %" PRIu64 "\n", idx);
+        fflush(file);
+    }
+
+    ~TDD_Driver_Trace () {
+        if (file) {
+            fclose(file);
+        }
+    }
+};
+
+inline TDD_Driver_Trace __TDD_trace;
+
+struct TDD_Driver_Node_Stats {
+    uint64_t runs;
+    // returned false and stopped the input
+    uint64_t fails;
+    // failures where a pointer loader read a null pointer
+    uint64_t nullPtrs;
+    uint64_t nanoseconds;
+    uint64_t bytes;
+};
+
+struct TDD_Driver_Stats_Header {
+    char magic[8];
+    uint64_t nodeCount;
+    uint64_t inputs;
+};
+
+// TDD_DRIVER_STATS=<file> keeps per-node counters in a shared mapping of the file, emptied when the
+// driver starts. forked children update it too, TDD_DriverStats.py reads it while the driver runs.
+// one file per fuzzing process.
+struct TDD_Driver_Stats {
+    TDD_Driver_Stats_Header* header = nullptr;
+    TDD_Driver_Node_Stats* nodes = nullptr;
+    uint64_t current = 0, read = 0;
+    std::chrono::steady_clock::time_point start;
+
+    explicit TDD_Driver_Stats (uint64_t nodeCount) {
+        const char* fileName = getenv("TDD_DRIVER_STATS");
+        if (!fileName || !fileName[0]) {
+            return;
+        }
+        uint64_t size = sizeof (TDD_Driver_Stats_Header) + nodeCount * sizeof (TDD_Driver_Node_Stats);
+        int fd = open(fileName, O_RDWR | O_CREAT | O_TRUNC, 0644);
+        __TDD_ASSERT (fd >= 0, "can NOT open " << fileName);
+        if (ftruncate(fd, size) != 0) {
+            __TDD_ASSERT (false, "can NOT resize " << fileName);
+        }
+        void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        __TDD_ASSERT (data != MAP_FAILED, "can NOT map " << fileName);
+        header = (TDD_Driver_Stats_Header*) (data);
+        memcpy(header->magic, "TDDSTAT1", sizeof (header->magic));
+        header->nodeCount = nodeCount;
+        nodes = (TDD_Driver_Node_Stats*) (header + 1);
+    }
+
+    void begin (uint64_t node) {
+        ++nodes[node].runs;
+        current = node;
+        read = __TDD_global_read;
+        start = std::chrono::steady_clock::now();
+    }
+
+    void end (uint64_t node, bool succeed) {
+        nodes[node].nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        nodes[node].bytes += __TDD_global_read - read;
+        nodes[node].fails += !succeed;
+    }
+
+    void null () {
+        ++nodes[current].nullPtrs;
+    }
+};
+
+// defined with the graph in __TDDDriver.cc
+extern TDD_Driver_Stats __TDD_stats;
+
+// a pointer loader read idx as null
+inline void __TDD_driver_null_ptr (uint64_t idx) {
+    if (__TDD_trace.file) {
+        __TDD_trace.null(idx);
+    }
+    if (__TDD_stats.nodes) {
+        __TDD_stats.null();
+    }
+}
+
+// 8 input bytes, most significant first
+inline uint64_t __TDD_driver_integer () {
+    uint64_t ret;
+    __TDD_driver_read(&ret, sizeof (ret));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    ret = __builtin_bswap64(ret);
+#endif
+    return ret;
+}
+
+// [0, 1) from the top 53 bits of an integer
+inline double __TDD_driver_floating () {
+    return (double) (__TDD_driver_integer() >> 11) * 0x1.0p-53;
+}
+
+inline uint64_t __TDD_driver_size () {
+    uint64_t size = __TDD_driver_integer();
+    size %= __TDD_DRIVER_MAX_SIZE - __TDD_DRIVER_MIN_SIZE + 1;
+    size += __TDD_DRIVER_MIN_SIZE;
+    return size;
+}
+
+// one of the enumerators, or any union of them for a flag enum
+inline int64_t __TDD_driver_enum_value (std::initializer_list<int64_t> values, bool isFlag) {
+    if (!isFlag) {
+        return *(values.begin() + __TDD_driver_integer() % values.size());
+    }
+    uint64_t bits = __TDD_driver_integer();
+    int64_t ret = 0;
+    for (int64_t value : values) {
+        if (bits & 1) {
+            ret |= value;
+        }
+        bits >>= 1;
+    }
+    return ret;
+}
+
+inline void* __TDD_driver_alloc (uint64_t size, bool allZero = true) {
+    uint8_t* ret = (uint8_t*) (__TDD_arena.alloc(size));
+    if (!allZero) {
+        __TDD_driver_read(ret, size);
+    } else {
+        memset(ret, 0, size);
+    }
+    return ret;
+}
+
+inline void* __TDD_driver_string (uint64_t& size) {
+    uint8_t* ret;
+    size = __TDD_driver_size();
+    ret = (uint8_t*) (__TDD_arena.alloc(size + 1));
+    __TDD_driver_read(ret, size);
+    ret[size] = '\0';
+    return ret;
+}
+
+template <typename T>
+void* __TDD_driver_typed_alloc (uint64_t& size) {
+    if (std::is_reference_v<T>) {
+        size = sizeof (std::remove_reference_t<T>);
+    } else if (std::is_pointer_v<T>) {
+        size = sizeof (std::remove_pointer_t<T>);
+    } else {
+        __TDD_ASSERT (false, "__TDD_driver_typed_alloc without a reference or pointer type");
+    }
+    if (size != 1) {
+        return __TDD_driver_alloc(size);
+    } else {
+        return __TDD_driver_string(size);
+    }
+}
+
+template <>
+inline void* __TDD_driver_typed_alloc<void*> (uint64_t& size) {
+    return __TDD_driver_string(size);
+}
+
+template <>
+inline void* __TDD_driver_typed_alloc<const void*> (uint64_t& size) {
+    return __TDD_driver_string(size);
+}
+
+// a pointer that is neither returned nor loaded yet is a buffer the driver allocates as T
+template <typename T, typename S>
+void __TDD_driver_alloc_ptr (S& ptr, uint64_t& size) {
+    if (!ptr) {
+        ptr = (S) (__TDD_driver_typed_alloc<T>(size));
+    }
+}
+
+template <typename T>
+T __TDD_driver_get_typed_object (const void* base, int64_t offset) {
+    if (std::is_reference_v<T>) {
+        return *(std::add_pointer_t<std::remove_reference_t<T>>) (((char*) base) + offset);
+    } else if (std::is_pointer_v<T>) {
+        return (T) (((char*) base) + offset);
+    } else {
+        __TDD_ASSERT (false, "__TDD_driver_get_typed_object without a reference or pointer type");
+    }
+}
+
+template <>
+inline void* __TDD_driver_get_typed_object<void*> (const void* base, int64_t offset) {
+    return (void*) (((char*) base) + offset);
+}
+
+template <>
+inline const void* __TDD_driver_get_typed_object<const void*> (const void* base, int64_t offset) {
+    return (void*) (((char*) base) + offset);
+}
+
+template <typename T>
+T __TDD_driver_get_typed_value () {
+    if (std::is_integral_v<T>) {
+        return (T) (__TDD_driver_integer());
+    } else if (std::is_floating_point_v<T>) {
+        return (T) (__TDD_driver_floating());
+    } else {
+        return {};
+    }
+}
+
+template <typename T, typename S>
+void __TDD_driver_set_ptr (S& ptr, T value) {
+    __TDD_ASSERT (!ptr, "set on existing ptr");
+    if (std::is_reference_v<T>) {
+        ptr = (S) ((void*) (&value));
+    } else if (std::is_pointer_v<T>) {
+        ptr = (S) ((void*) (value));
+    } else {
+        __TDD_ASSERT (false, "__TDD_driver_set_ptr without a reference or pointer type");
+    }
+}
+
+// an in-memory file holding the next size input bytes, -1 if memfd is not available
+inline int __TDD_driver_memfd (uint64_t size) {
+#ifdef __linux__
+    int fd = memfd_create("__TDD_file", 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (ftruncate(fd, size) != 0) {
+        close(fd);
+        return -1;
+    }
+    if (size) {
+        void* data = mmap(nullptr, size, PROT_WRITE, MAP_SHARED, fd, 0);
+        if (data == MAP_FAILED) {
+            close(fd);
+            return -1;
+        }
+        __TDD_driver_read(data, size);
+        munmap(data, size);
+    }
+    return fd;
+#else
+    return -1;
+#endif
+}
+
+inline void* __TDD_driver_file_name () {
+    uint64_t size = __TDD_driver_size();
+    std::string realFileName;
+    int fd = __TDD_driver_memfd(size);
+    if (fd >= 0) {
+        // every open of the path starts at offset 0 of the same memory
+        realFileName = "/proc/self/fd/" + std::to_string(fd);
+        __TDD_driver_register_free([=] () {close(fd);});
+    } else {
+        realFileName = "__TDD_file_" + std::to_string(__TDD_file_count++);
+        remove(realFileName.c_str());
+        FILE* file = fopen(realFileName.c_str(), "w");
+        uint8_t* tmp = (uint8_t*) (malloc(size));
+        __TDD_driver_read(tmp, size);
+        fwrite(tmp, size, 1, file);
+        free(tmp);
+        fclose(file);
+    }
+    void* ret = __TDD_arena.alloc(realFileName.size() + 1);
+    memcpy(ret, realFileName.c_str(), realFileName.size());
+    ((char*) (ret))[realFileName.size()] = '\0';
+    return ret;
+}
+
+inline std::string __TDD_driver_std_string () {
+    std::string ret;
+    uint64_t size = __TDD_driver_size();
+    ret.resize(size);
+    __TDD_driver_read(ret.data(), size);
+    return ret;
+}
+
+// backed by a memfd so fileno / fstat keep working, fmemopen without one
+inline FILE* __TDD_driver_FILEptr () {
+    uint64_t size = __TDD_driver_size();
+    FILE* ret = nullptr;
+    int fd = __TDD_driver_memfd(size);
+    if (fd >= 0) {
+        ret = fdopen(fd, "r+");
+    } else {
+        void* buffer = __TDD_driver_alloc(std::max<uint64_t>(size, 1));
+        __TDD_driver_read(buffer, size);
+        ret = fmemopen(buffer, std::max<uint64_t>(size, 1), "r+");
+    }
+    __TDD_ASSERT (ret, "can NOT open a FILE* on the input");
+    __TDD_driver_register_free([=] () {fclose(ret);});
+    return ret;
+}
+
+inline void __TDD_swap (uint64_t& a, uint64_t& b) {
+    if (&a != &b) {
+        a ^= b;
+        b ^= a;
+        a ^= b;
+    }
+}
+
+inline void __TDD_driver_init (const uint8_t* buffer, size_t size) {
+    TDD_Driver_Layout layout(buffer, size);
+    __TDD_sectioned = layout.sectioned;
+    __TDD_schedule_end    = layout.schedule + layout.scheduleSize;
+    __TDD_schedule_cursor = layout.schedule;
+    __TDD_sections_end    = layout.sections + layout.sectionsSize;
+    __TDD_sections_cursor = layout.sections;
+    __TDD_section_idx = __TDD_UNEG1;
+    // nothing is read before the first section, the unsectioned stream is read from the start
+    __TDD_global_begin  = layout.sectioned ? nullptr : layout.sections;
+    __TDD_global_end    = layout.sectioned ? nullptr : __TDD_sections_end;
+    __TDD_global_cursor = __TDD_global_begin;
+    if (__TDD_trace.file) {
+        __TDD_trace.input(size);
+    }
+    if (__TDD_stats.nodes) {
+        ++__TDD_stats.header->inputs;
+    }
+    __TDD_file_count = 0;
+    __TDD_funcitons_run_on_exit.clear();
+}
+
+int __TDD_driver_main ();
+int __TDD_driver_fork_main ();
+
+// TDD_DRIVER_FORK=1 runs every input in a forked child, see __TDD_driver_fork_main
+inline const bool __TDD_fork_mode = [] () {
+    const char* env = getenv("TDD_DRIVER_FORK");
+    return env && env[0] == '1';
+}();
+
+inline void __TDD_driver_fin () {
+    while (!__TDD_funcitons_run_on_exit.empty()) {
+        auto func = __TDD_funcitons_run_on_exit.back();
+        func();
+        __TDD_funcitons_run_on_exit.pop_back();
+    }
+    __TDD_arena.reset();
+    __TDD_global_begin  = nullptr;
+    __TDD_global_end    = nullptr;
+    __TDD_global_cursor = nullptr;
+    __TDD_schedule_end    = nullptr;
+    __TDD_schedule_cursor = nullptr;
+    __TDD_sections_end    = nullptr;
+    __TDD_sections_cursor = nullptr;
+}
+
+} // namespace TDD
+
+#endif // __TDD_DRIVER_SHARED
+
+// TDD driver, the pointers of the calling chain. they change with every generation, a sharded driver
+// keeps them out of the precompiled header : see TDD_DriverGenerator.py
+
+#ifndef __TDD_DRIVER_POINTERS
+#define __TDD_DRIVER_POINTERS
+
+namespace TDD {
+
+inline constexpr uint64_t __TDD_pointer_count = /* @@ POINTER COUNT @@ */;
+
+// ptr_N holds pointer id N with the type the nodes use it as (void* if they disagree),
+// size[N] the size of the buffer the driver allocated for it
+struct TDD_Driver_Pointers {
+    // @@ POINTER FIELDS @@
+    uint64_t size[__TDD_pointer_count + 1] = {};
+};
+
+// pointer id -> offset of ptr_N, for the code that only knows the id. ends with one unused entry
+inline const size_t __TDD_ptr_offsets[] = {/* @@ POINTER OFFSETS @@ */};
+
+inline TDD_Driver_Pointers __TDD_ptrs;
+
+inline void* __TDD_driver_ptr_value (const TDD_Driver_Pointers& ptrs, uint64_t idx) {
+    return *(void* const*) (((const char*) (&ptrs)) + __TDD_ptr_offsets[idx]);
+}
+
+// Pointer loaders, straight-line walks of the load chains. a loaded pointer is kept for the rest
+// of the input, the nodes that may write one of its sources clear it so it is loaded again
+// @@ POINTER LOADERS @@
+
+} // namespace TDD
+
+#endif // __TDD_DRIVER_POINTERS
@@ -0,0 +1,77 @@
+# !/usr/bin/env python3
+# coding = utf-8
+
+import json
+import os
+import struct
+import sys
+from typing import Dict, List, Tuple
+
+# layout written by TDD_DriverSkeleton.h (TDD_Driver_Stats)
+STATS_MAGIC  : bytes = b"TDDSTAT1"
+HEADER_SIZE  : int   = 8 + 8 + 8
+NODE_FORMAT  : str   = "<QQQQQ"
+NODE_SIZE    : int   = struct.calcsize(NODE_FORMAT)
+
+class NodeStats:
+    __slots__ = ("runs", "fails", "nullPtrs", "nanoseconds", "bytes")
+    runs : int
+    fails : int
+    nullPtrs : int
+    nanoseconds : int
+    bytes : int
+
+def loadStats(fileName : str) -> Tuple[int, List[NodeStats]]:
+    """
+    the number of inputs and the counters of every node. the driver may be updating the file,
+    a counter read in the middle of an update is off by one input at most.
+    """
+    assert os.path.exists(fileName), f"{fileName} does not exist, run the driver with TDD_DRIVER_STATS={fileName}"
+    with open(fileName, "rb") as f:
+        data = f.read()
+    assert data[: len(STATS_MAGIC)] == STATS_MAGIC, f"{fileName} is not written by a driver"
+    nodeCount, inputs = struct.unpack_from("<QQ", data, len(STATS_MAGIC))
+    assert len(data) >= HEADER_SIZE + nodeCount * NODE_SIZE, f"{fileName} is truncated"
+    ret : List[NodeStats] = []
+    for idx in range(nodeCount):
+        stats = NodeStats()
+        stats.runs, stats.fails, stats.nullPtrs, stats.nanoseconds, stats.bytes = struct.unpack_from(NODE_FORMAT, data, HEADER_SIZE + idx * NODE_SIZE)
+        ret.append(stats)
+    return inputs, ret
+
+def loadNodeNames(fileName : str = "__TDDFinalCallingChain.json", declFileName : str = "__TDDDeclarations.json") -> List[str]:
+    """
+    the chain keeps mangled names, the declarations map them to the qualified names with template arguments.
+    """
+    if not os.path.exists(fileName):
+        return []
+    declNames : Dict[str, str] = {}
+    if os.path.exists(declFileName):
+        with open(declFileName, "rt") as f:
+            declNames = {key : decl.get("name", key) for key, decl in json.load(f).items()}
+    with open(fileName, "rt") as f:
+        return ["(root)" if node is None else declNames.get(node["name"], node["name"]) for node in json.load(f)["nodes"]]
+
+if __name__ == "__main__":
+    if len(sys.argv) not in (2, 3, 4):
+        raise ValueError(f"Usage : python {sys.argv[0]} <stats file> [final calling chain, default __TDDFinalCallingChain.json] "
+                         f"[declarations, default __TDDDeclarations.json]")
+    inputs, nodes = loadStats(sys.argv[1])
+    names = loadNodeNames(*sys.argv[2 :])
+    print(f"{inputs} inputs")
+    print(f"{'node':>6} {'runs':>12} {'fails':>12} {'null ptr':>12} {'avg us':>10} {'avg bytes':>10}  name")
+    neverRun : List[int] = []
+    alwaysFail : List[int] = []
+    for idx, stats in enumerate(nodes[1 :], start = 1):
+        name = names[idx] if idx < len(names) else ""
+        if stats.runs == 0:
+            neverRun.append(idx)
+            print(f"{idx:>6} {0:>12} {'-':>12} {'-':>12} {'-':>10} {'-':>10}  {name}")
+            continue
+        if stats.fails == stats.runs:
+            alwaysFail.append(idx)
+        averageTime = stats.nanoseconds / stats.runs / 1000
+        averageBytes = stats.bytes / stats.runs
+        print(f"{idx:>6} {stats.runs:>12} {stats.fails:>12} {stats.nullPtrs:>12} {averageTime:>10.2f} {averageBytes:>10.1f}  {name}")
+    print(f"never run : {' '.join(str(idx) for idx in neverRun) or '-'}")
+    print(f"always fail : {' '.join(str(idx) for idx in alwaysFail) or '-'}")
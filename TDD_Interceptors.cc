@@ -1,4 +1,6 @@
+#include <cstdarg>
 #include <cstdlib>
+#include <cxxabi.h>
 #include <dlfcn.h>
 #include <fcntl.h>
 #include <vector>
@@ -96,15 +98,92 @@ struct FunctionParameter {
 };
 const void* functionReturn;
 
+// SAX handler keeping only "declaration key -> call name" of __TDDDeclarations.json,
+// the full document is never built in memory
+class DeclarationsSax : public nlohmann::json_sax<nlohmann::json> {
+private:
+    std::map<std::string, std::string>& functionList;
+    uint64_t depth = 0;
+    std::string currentKey;
+    bool isNameValue = false;
+
+    bool skipValue () {
+        isNameValue = false;
+        return true;
+    }
+public:
+    explicit DeclarationsSax (std::map<std::string, std::string>& functionList_) : functionList(functionList_) {}
+
+    bool null () override {return skipValue();}
+    bool boolean (bool) override {return skipValue();}
+    bool number_integer (number_integer_t) override {return skipValue();}
+    bool number_unsigned (number_unsigned_t) override {return skipValue();}
+    bool number_float (number_float_t, const string_t&) override {return skipValue();}
+    bool binary (binary_t&) override {return skipValue();}
+    bool string (string_t& value) override {
+        if (isNameValue) {
+            functionList[currentKey] = value;
+        }
+        return skipValue();
+    }
+    bool start_object (std::size_t) override {
+        isNameValue = false;
+        ++depth;
+        return true;
+    }
+    bool end_object () override {
+        --depth;
+        return true;
+    }
+    bool start_array (std::size_t) override {
+        isNameValue = false;
+        ++depth;
+        return true;
+    }
+    bool end_array () override {
+        --depth;
+        return true;
+    }
+    bool key (string_t& value) override {
+        if (depth == 1) {
+            currentKey = value;
+            functionList.emplace(currentKey, currentKey);
+        } else if (depth == 2 && value == "name") {
+            isNameValue = true;
+        }
+        return true;
+    }
+    bool parse_error (std::size_t position, const std::string&, const nlohmann::detail::exception& ex) override {
+        ASSERT (false, "__TDDDeclarations.json parse error at " << position << " : " << ex.what());
+        return false;
+    }
+};
+
 std::string getInterestingName (std::string functionName, bool check = true) {
-    static nlohmann::json functionList;
+    static std::map<std::string, std::string> functionList;
     static bool hasFunctionList = false;
     if (UNLIKELY(!hasFunctionList)) {
         hasFunctionList = true;
         std::ifstream is;
         is.open("__TDDDeclarations.json");
         ASSERT (is.is_open(), "__TDDDeclarations.json not exist");
-        is >> functionList;
+        DeclarationsSax sax(functionList);
+        nlohmann::json::sax_parse(is, &sax);
+    }
+    // declarations are keyed by mangled name, see TDD_NewSuite.cc
+    auto it = functionList.find(functionName);
+    if (it != functionList.end()) {
+        if (UNLIKELY(!check)) {return it->second;}
+        return functionName;
+    } else if (LIKELY(check)) {
+        return "";
+    }
+    // a function pointer to a non-API function : its demangled name without the parameter list
+    int status = 0;
+    char* demangledName = abi::__cxa_demangle(functionName.c_str(), nullptr, nullptr, &status);
+    if (demangledName) {
+        functionName = demangledName;
+        free(demangledName);
     }
     std::string realFunctionName;
     for (const char& c : functionName) {
@@ -121,70 +200,145 @@ std::string getInterestingName (std::string functionName, bool check = true) {
             break;
         }
     }
-    if (UNLIKELY(!check)) {return realFunctionName;}
-    else if (functionList.count(realFunctionName)) {return realFunctionName;}
-    else {return "";}
+    return realFunctionName;
 }
 
-std::vector<std::pair<nlohmann::json, bool>> allTraces;
-nlohmann::json getSimplifiedTrace () {
+// one CALL or LOAD of the calling chain, streamed to __TDDCallingChain.json by dumpTrace
+struct TraceParameter {
+    // FunctionCall.FunctionParameterType of TDD_DriverGenerator.py, NULL is a macro here
+    enum struct FunctionParameterType {CONST, PTR_SIZE, NULLPTR, FILE_PATH, PTR, FUNC};
+    uint64_t idx;
+    FunctionParameterType paramType;
+    int64_t value;
+    uint64_t ptrIndex;
+    int64_t offset;
+    std::string name;
+};
+
+struct Trace {
+    enum struct TraceType {CALL, LOAD};
+    TraceType type;
+    bool used;
+    // CALL
+    std::string name;
+    bool hasReturn;
+    uint64_t returnIdx;
+    std::vector<TraceParameter> parameters;
+    // LOAD
+    uint64_t address;
+    int64_t offset;
+    uint64_t value;
+};
+
+std::vector<Trace> allTraces;
+void simplifyTrace () {
     std::map<uint64_t, uint64_t> usedPtrIndex;
     uint64_t realIndex = 0;
 
-    for (std::pair<nlohmann::json, bool>& subTrace : allTraces) {
-        nlohmann::json& subJ = subTrace.first;
-        std::string type = subJ.at("type").get<std::string>();
-        if (type == "CALL") {
-            for (nlohmann::json& param : subJ.at("parameters")) {
-                if (param.at("paramType").get<std::string>() == "PTR") {
-                    uint64_t ptrIdx = param.at("ptrIndex").get<uint64_t>();
-                    if (!usedPtrIndex.count(ptrIdx)) {
-                        usedPtrIndex[ptrIdx] = realIndex++;
+    for (Trace& trace : allTraces) {
+        if (trace.type == Trace::TraceType::CALL) {
+            for (TraceParameter& param : trace.parameters) {
+                if (param.paramType == TraceParameter::FunctionParameterType::PTR) {
+                    if (!usedPtrIndex.count(param.ptrIndex)) {
+                        usedPtrIndex[param.ptrIndex] = realIndex++;
                     }
-                    param["ptrIndex"] = usedPtrIndex.at(ptrIdx);
+                    param.ptrIndex = usedPtrIndex.at(param.ptrIndex);
                 }
             }
-            if (subJ.count("return")) {
-                uint64_t ptrIdx = subJ.at("return").get<uint64_t>();
-                if (!usedPtrIndex.count(ptrIdx)) {
-                    usedPtrIndex[ptrIdx] = realIndex++;
+            if (trace.hasReturn) {
+                if (!usedPtrIndex.count(trace.returnIdx)) {
+                    usedPtrIndex[trace.returnIdx] = realIndex++;
                 }
-                subJ["return"] = usedPtrIndex.at(ptrIdx);
+                trace.returnIdx = usedPtrIndex.at(trace.returnIdx);
             }
-            subTrace.second = true;
-        } else if (type != "LOAD") {
-            ASSERT (false, "Unknown type : " << type);
+            trace.used = true;
         }
     }
 
     bool hasChanged = true;
     while (hasChanged) {
         hasChanged = false;
-        for (std::pair<nlohmann::json, bool>& subTrace : allTraces) {
-            nlohmann::json& subJ = subTrace.first;
-            std::string type = subJ.at("type").get<std::string>();
-            if (type == "LOAD" && !subTrace.second) {
-                uint64_t address = subJ.at("address").get<uint64_t>();
-                uint64_t value = subJ.at("value").get<uint64_t>();
-                if (usedPtrIndex.count(address) && usedPtrIndex.count(value)) {
-                    subJ["address"] = usedPtrIndex.at(address);
-                    subJ["value"] = usedPtrIndex.at(value);
-                    subTrace.second = true;
+        for (Trace& trace : allTraces) {
+            if (trace.type == Trace::TraceType::LOAD && !trace.used) {
+                if (usedPtrIndex.count(trace.address) && usedPtrIndex.count(trace.value)) {
+                    trace.address = usedPtrIndex.at(trace.address);
+                    trace.value = usedPtrIndex.at(trace.value);
+                    trace.used = true;
                     hasChanged = true;
                 }
-            } else if (type != "LOAD" && type != "CALL") {
-                ASSERT (false, "Unknown type : " << type);
             }
         }
     }
+}
 
-    nlohmann::json ret = nlohmann::json::array();
-    for (std::pair<nlohmann::json, bool>& subTrace : allTraces) {
-        if (subTrace.second) {
-            ret.push_back(subTrace.first);
+void dumpString (std::ostream& os, const std::string& value) {
+    os << '"';
+    for (char c : value) {
+        if (c == '"' || c == '\\') {
+            os << '\\' << c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char escaped[8];
+            snprintf(escaped, sizeof (escaped), "\\u%04x", c);
+            os << escaped;
+        } else {
+            os << c;
         }
     }
-    return ret;
+    os << '"';
+}
+
+const char* getParameterTypeName (TraceParameter::FunctionParameterType type) {
+    if (type == TraceParameter::FunctionParameterType::CONST) {
+        return "CONST";
+    } else if (type == TraceParameter::FunctionParameterType::PTR_SIZE) {
+        return "PTR_SIZE";
+    } else if (type == TraceParameter::FunctionParameterType::NULLPTR) {
+        return "NULL";
+    } else if (type == TraceParameter::FunctionParameterType::FILE_PATH) {
+        return "FILE_PATH";
+    } else if (type == TraceParameter::FunctionParameterType::PTR) {
+        return "PTR";
+    } else {
+        return "FUNC";
+    }
+}
+
+// compact json, the same layout TDD_OUSMerger.py reads
+void dumpTrace (std::ostream& os) {
+    bool firstTrace = true;
+    os << '[';
+    for (const Trace& trace : allTraces) {
+        if (!trace.used) {continue;}
+        if (!firstTrace) {os << ',';}
+        firstTrace = false;
+        if (trace.type == Trace::TraceType::LOAD) {
+            os << "{\"type\":\"LOAD\",\"address\":" << trace.address << ",\"offset\":" << trace.offset << ",\"value\":" << trace.value << '}';
+            continue;
+        }
+        os << "{\"type\":\"CALL\",\"name\":";
+        dumpString(os, trace.name);
+        if (trace.hasReturn) {
+            os << ",\"return\":" << trace.returnIdx;
+        }
+        os << ",\"parameters\":[";
+        bool firstParam = true;
+        for (const TraceParameter& param : trace.parameters) {
+            if (!firstParam) {os << ',';}
+            firstParam = false;
+            os << "{\"idx\":" << param.idx << ",\"paramType\":\"" << getParameterTypeName(param.paramType) << '"';
+            if (param.paramType == TraceParameter::FunctionParameterType::CONST) {
+                os << ",\"value\":" << param.value;
+            } else if (param.paramType == TraceParameter::FunctionParameterType::PTR) {
+                os << ",\"ptrIndex\":" << param.ptrIndex << ",\"offset\":" << param.offset;
+            } else if (param.paramType == TraceParameter::FunctionParameterType::FUNC) {
+                os << ",\"name\":";
+                dumpString(os, param.name);
+            }
+            os << '}';
+        }
+        os << "]}";
+    }
+    os << "]\n";
 }
 
 } // namspace (anonymous)
@@ -275,7 +429,13 @@ void TDD_traceAlloca (const void* ptr, uint64_t size) {
 void TDD_traceLoad (const void* address, int64_t offset, const void* value) {
     if (ifTrack && buffers.count(address) && !buffers.count(value)) {
         ifTrack = false;
-        allTraces.push_back({{{"type", "LOAD"}, {"address", buffers[address].second}, {"offset", offset}, {"value", bufferIdx}}, false});
+        Trace trace;
+        trace.type = Trace::TraceType::LOAD;
+        trace.used = false;
+        trace.address = buffers[address].second;
+        trace.offset = offset;
+        trace.value = bufferIdx;
+        allTraces.push_back(std::move(trace));
         buffers[value] = {0, bufferIdx++};
         ifTrack = true;
     }
@@ -305,11 +465,11 @@ void TDD_traceFuncParameter (uint64_t parameterIndex, char* funcName) {
     }
 }
 
-void TDD_traceCallPre (const char* demangledFunctionName) {
+void TDD_traceCallPre (const char* mangledFunctionName) {
     if (ifTrack) {
         ifTrack = false;
         functionReturn = nullptr;
-        currentFunction = getInterestingName(demangledFunctionName);
+        currentFunction = getInterestingName(mangledFunctionName);
         if (currentFunction.empty()) {
             ifTrack = true;
         }
@@ -320,60 +480,53 @@ void TDD_traceReturnValue (const void* ptr) {
     functionReturn = ptr;
 }
 
-void TDD_traceCallPost (const char* demangledFunctionName) {
-    if (!currentFunction.empty() && currentFunction == getInterestingName(demangledFunctionName)) {
-        nlohmann::json result = nlohmann::json::object();
-        result["type"] = "CALL";
-        result["name"] = currentFunction;
+void TDD_traceCallPost (const char* mangledFunctionName) {
+    if (!currentFunction.empty() && currentFunction == getInterestingName(mangledFunctionName)) {
+        Trace result;
+        result.type = Trace::TraceType::CALL;
+        result.used = false;
+        result.name = currentFunction;
+        result.hasReturn = false;
         if (functionReturn && !buffers.count(functionReturn)) {
-            result["return"] = bufferIdx;
+            result.hasReturn = true;
+            result.returnIdx = bufferIdx;
             buffers[functionReturn] = {0, bufferIdx++};
         }
-        nlohmann::json parameterResult = nlohmann::json::array();
         for (uint64_t idx = 0; idx < functionParameters.size(); ++idx) {
-            nlohmann::json thisResult = nlohmann::json::object();
+            TraceParameter thisResult;
             const FunctionParameter& thisParameter = functionParameters.at(idx);
+            thisResult.idx = thisParameter.idx;
             if (thisParameter.type == FunctionParameter::FunctionParameterType::INT) {
                 int64_t value = thisParameter.intValue;
                 if (value == -1 || value == 0 || value == 1) {
-                    thisResult["idx"] = thisParameter.idx;
-                    thisResult["paramType"] = "CONST";
-                    thisResult["value"] = value;
-                    parameterResult.emplace_back(thisResult);
+                    thisResult.paramType = TraceParameter::FunctionParameterType::CONST;
+                    thisResult.value = value;
+                    result.parameters.push_back(std::move(thisResult));
                 } else if (thisParameter.isPreviousSize) {
-                    thisResult["idx"] = thisParameter.idx;
-                    thisResult["paramType"] = "PTR_SIZE";
-                    parameterResult.emplace_back(thisResult);
+                    thisResult.paramType = TraceParameter::FunctionParameterType::PTR_SIZE;
+                    result.parameters.push_back(std::move(thisResult));
                 }
             } else if (thisParameter.type == FunctionParameter::FunctionParameterType::PTR) {
                 const void* value = thisParameter.ptrValue;
                 if (!value) {
-                    thisResult["idx"] = thisParameter.idx;
-                    thisResult["paramType"] = "NULL";
-                    parameterResult.emplace_back(thisResult);
+                    thisResult.paramType = TraceParameter::FunctionParameterType::NULLPTR;
                 } else if (fileNames.count(value)) {
-                    thisResult["idx"] = thisParameter.idx;
-                    thisResult["paramType"] = "FILE_PATH";
-                    parameterResult.emplace_back(thisResult);
+                    thisResult.paramType = TraceParameter::FunctionParameterType::FILE_PATH;
                 } else {
-                    thisResult["idx"] = thisParameter.idx;
-                    thisResult["paramType"] = "PTR";
-                    thisResult["ptrIndex"] = thisParameter.ptrIdx;
-                    thisResult["offset"] = thisParameter.offset;
-                    parameterResult.emplace_back(thisResult);
+                    thisResult.paramType = TraceParameter::FunctionParameterType::PTR;
+                    thisResult.ptrIndex = thisParameter.ptrIdx;
+                    thisResult.offset = thisParameter.offset;
                 }
+                result.parameters.push_back(std::move(thisResult));
             } else if (thisParameter.type == FunctionParameter::FunctionParameterType::FUNC) {
-                std::string funcName = thisParameter.funcValue;
-                thisResult["idx"] = thisParameter.idx;
-                thisResult["paramType"] = "FUNC";
-                thisResult["name"] = getInterestingName(funcName, false);
-                parameterResult.emplace_back(thisResult);
+                thisResult.paramType = TraceParameter::FunctionParameterType::FUNC;
+                thisResult.name = getInterestingName(thisParameter.funcValue, false);
+                result.parameters.push_back(std::move(thisResult));
             } else {
                 ASSERT (false, "unknown parameter type");
             }
         }
-        result["parameters"] = parameterResult;
-        allTraces.push_back({result, false});
+        allTraces.push_back(std::move(result));
     }
     currentFunction.clear();
     functionParameters.clear();
@@ -419,10 +572,10 @@ void TDD_startCase () {
 void TDD_endCase () {
     ifTrack = false;
     if (!checkEnv("TDD_NO_CHAIN")) {
-        getSimplifiedTrace();
+        simplifyTrace();
         std::ofstream os;
         os.open("__TDDCallingChain.json");
-        os << getSimplifiedTrace().dump(4);
+        dumpTrace(os);
     }
 }
 
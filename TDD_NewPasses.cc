@@ -6,7 +6,6 @@
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/FileSystem.h"
-#include "llvm/Demangle/Demangle.h"
 
 #include <iostream>
 #include <fstream>
@@ -14,8 +13,6 @@
 #include <map>
 #include <set>
 
-#include "json.hpp"
-
 #define ASSERT(cond, msg) if (UNLIKELY (!(cond))) {llvm::errs() << msg << " !! \n"; abort();} void(0)
 #define CAST(type, name, from) type* name = llvm::cast<type>(from)
 #define DYN_CAST(type, name, from) if (type* name = llvm::dyn_cast<type>(from))
@@ -117,24 +114,6 @@ bool isInterestingCaseFile (llvm::StringRef fileName) {
     return false;
 }
 
-void openAndUpdate (const char* fileName, const nlohmann::json& j) {
-    nlohmann::json fullJ;
-    std::ifstream inputStream;
-    inputStream.open(fileName);
-    if (inputStream.is_open()) {
-        inputStream >> fullJ;
-    } else {
-        fullJ = nlohmann::json::object();
-    }
-    inputStream.close();
-
-    fullJ.update(j);
-    std::ofstream outputStream;
-    outputStream.open(fileName);
-    outputStream << fullJ.dump(4);
-    outputStream.close();
-}
-
 bool shouldFunctionBeInstructed (llvm::Function& F) {
     if (!F.isDeclaration() && !F.isIntrinsic() && !F.getName().startswith("TDD_") && F.hasMetadata("dbg")) {
         DYN_CAST (llvm::DISubprogram, pDbgMeta, F.getMetadata("dbg")) {
@@ -233,8 +212,8 @@ void ScanModuleAndInstruct (llvm::Module& M) {
                         if (call.getCalledFunction()) {
                             llvm::Function& calledFunc = *call.getCalledFunction();
                             if (!shouldFunctionBeTraced(calledFunc)) {continue;}
-                            std::string demangledName = llvm::demangle(calledFunc.getName().str());
-                            llvm::Constant& demangledNamePtr = *builder.CreateGlobalStringPtr(demangledName);
+                            // mangled names are the keys of __TDDDeclarations.json, overloads stay apart
+                            llvm::Constant& mangledNamePtr = *builder.CreateGlobalStringPtr(calledFunc.getName());
                             for (uint64_t idx = 0; idx < call.arg_size(); ++idx) {
                                 llvm::Value& arg = *call.getArgOperand(idx);
                                 if (arg.getType()->isIntegerTy()) {
@@ -242,8 +221,7 @@ void ScanModuleAndInstruct (llvm::Module& M) {
                                 } else if (arg.getType()->isPointerTy()) {
                                     DYN_CAST (llvm::Function, pFuncArg, &arg) {
                                         llvm::Function& funcArg = *pFuncArg;
-                                        std::string demangledFuncArgName = llvm::demangle(funcArg.getName().str());
-                                        builder.CreateCall(TDD_traceFuncParameter, {builder.getInt64(idx), builder.CreateGlobalStringPtr(demangledFuncArgName)});
+                                        builder.CreateCall(TDD_traceFuncParameter, {builder.getInt64(idx), builder.CreateGlobalStringPtr(funcArg.getName())});
                                     } else {
                                         llvm::Value* pSrc = &arg;
                                         llvm::Value* pOffset = builder.getInt64(0);
@@ -256,12 +234,12 @@ void ScanModuleAndInstruct (llvm::Module& M) {
                                     }
                                 }
                             }
-                            builder.CreateCall(TDD_traceCallPre, {&demangledNamePtr});
+                            builder.CreateCall(TDD_traceCallPre, {&mangledNamePtr});
                             auto traceReturnAndDoPost = [&] () {
                                 if (call.getType()->isPointerTy()) {
                                     builder.CreateCall(TDD_traceReturnValue, {&call});
                                 }
-                                builder.CreateCall(TDD_traceCallPost, {&demangledNamePtr});
+                                builder.CreateCall(TDD_traceCallPost, {&mangledNamePtr});
                             };
                             DYN_CAST (llvm::CallInst, pCallInst, &call) {
                                 llvm::CallInst& callInst = *pCallInst;
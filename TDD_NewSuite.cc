@@ -1,4 +1,5 @@
 #include "clang/AST/AST.h"
+#include "clang/AST/Mangle.h"
 #include "clang/AST/QualTypeNames.h"
 #include "clang/AST/Type.h"
 #include "clang/AST/ASTConsumer.h"
@@ -6,14 +7,23 @@
 #include "clang/Basic/SourceManager.h"
 #include "clang/Frontend/FrontendPluginRegistry.h"
 #include "clang/Frontend/CompilerInstance.h"
+#include "clang/Lex/HeaderSearchOptions.h"
+#include "clang/Lex/Preprocessor.h"
 #include "clang/Sema/Sema.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
 #include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <vector>
 #include <map>
 #include <set>
@@ -117,22 +127,118 @@ bool isInterestingFile (llvm::StringRef fileName) {
     return false;
 }
 
-void openAndUpdate (const char* fileName, const nlohmann::json& j) {
-    nlohmann::json fullJ;
-    std::ifstream inputStream;
-    inputStream.open(fileName);
-    if (inputStream.is_open()) {
-        inputStream >> fullJ;
-    } else {
-        fullJ = nlohmann::json::object();
+uint64_t fnv1a (uint64_t hash, llvm::StringRef data) {
+    for (unsigned char c : data) {
+        hash ^= c;
+        hash *= 0x100000001b3ULL;
     }
-    inputStream.close();
+    return hash;
+}
+
+// incremental declarations database, one entry file per TU so that parallel compilers (make -j)
+// never read or rewrite the entries of other TUs
+//   "__TDDDatabase/<hash of the TU path>.bin" :
+//   "TDDDB004"  uint64 pathSize  path  uint64 declStamp  uint64 declSize  decl  uint64 depStamp  uint64 depSize  dep
+// decl / dep are compact json texts of one TU, a stamp of 0 means "not computed yet".
+// the magic is the schema version, bump it (and TDD_Database.py) whenever the layout or the decl / dep
+// json changes : it is folded into every stamp and entries of another version are computed again.
+// the json views are materialized on demand by TDD_Database.py
+
+const char* const DATABASE_DIR = "__TDDDatabase";
+const char DATABASE_MAGIC[8] = {'T', 'D', 'D', 'D', 'B', '0', '0', '4'};
+
+struct DatabaseEntry {
+    uint64_t declStamp = 0;
+    std::string decl;
+    uint64_t depStamp = 0;
+    std::string dep;
+};
+
+bool readUInt64 (std::istream& is, uint64_t& value) {
+    return static_cast<bool>(is.read(reinterpret_cast<char*>(&value), sizeof (value)));
+}
 
-    fullJ.update(j);
-    std::ofstream outputStream;
-    outputStream.open(fileName);
-    outputStream << fullJ.dump(4);
-    outputStream.close();
+bool readString (std::istream& is, std::string& value) {
+    uint64_t size;
+    if (!readUInt64(is, size)) {return false;}
+    value.resize(size);
+    return static_cast<bool>(is.read(value.data(), size));
+}
+
+void writeUInt64 (std::ostream& os, uint64_t value) {
+    os.write(reinterpret_cast<const char*>(&value), sizeof (value));
+}
+
+void writeString (std::ostream& os, const std::string& value) {
+    writeUInt64(os, value.size());
+    os.write(value.data(), value.size());
+}
+
+std::string getEntryFile (const std::string& tuPath) {
+    return std::string(DATABASE_DIR) + "/" + llvm::utohexstr(fnv1a(0xcbf29ce484222325ULL, tuPath)) + ".bin";
+}
+
+// an empty entry if the TU has none yet, or it was written by another schema version
+DatabaseEntry loadEntry (const std::string& tuPath) {
+    std::ifstream is(getEntryFile(tuPath), std::ios::binary);
+    if (!is.is_open()) {return DatabaseEntry();}
+    char magic[sizeof (DATABASE_MAGIC)];
+    std::string path;
+    DatabaseEntry entry;
+    if (
+        !is.read(magic, sizeof (magic)) || memcmp(magic, DATABASE_MAGIC, sizeof (magic)) ||
+        !readString(is, path) || path != tuPath ||
+        !readUInt64(is, entry.declStamp) || !readString(is, entry.decl) ||
+        !readUInt64(is, entry.depStamp) || !readString(is, entry.dep)
+    ) {
+        return DatabaseEntry();
+    }
+    return entry;
+}
+
+// written to a file of this process first, the rename replaces the entry at once
+void storeEntry (const std::string& tuPath, const DatabaseEntry& entry) {
+    ASSERT (!mkdir(DATABASE_DIR, 0755) || errno == EEXIST, "can NOT create " << DATABASE_DIR);
+    std::string entryFile = getEntryFile(tuPath);
+    std::string tmpFile = entryFile + "." + std::to_string(getpid()) + ".tmp";
+    std::ofstream os(tmpFile, std::ios::binary | std::ios::trunc);
+    ASSERT (os.is_open(), "can NOT write " << tmpFile);
+    os.write(DATABASE_MAGIC, sizeof (DATABASE_MAGIC));
+    writeString(os, tuPath);
+    writeUInt64(os, entry.declStamp);
+    writeString(os, entry.decl);
+    writeUInt64(os, entry.depStamp);
+    writeString(os, entry.dep);
+    os.close();
+    ASSERT (!rename(tmpFile.c_str(), entryFile.c_str()), "can NOT replace " << entryFile);
+}
+
+// schema version, content hash of the main file plus path / size / mtime of every file it includes, and of
+// the predefines (-D / -U, target and language macros) and include directories the TU was compiled with
+uint64_t getTUStamp (clang::CompilerInstance& CI) {
+    clang::SourceManager& manager = CI.getSourceManager();
+    uint64_t hash = fnv1a(0xcbf29ce484222325ULL, llvm::StringRef(DATABASE_MAGIC, sizeof (DATABASE_MAGIC)));
+    hash = fnv1a(hash, manager.getBufferData(manager.getMainFileID()));
+    hash = fnv1a(hash, CI.getPreprocessor().getPredefines());
+    for (const clang::HeaderSearchOptions::Entry& entry : CI.getHeaderSearchOpts().UserEntries) {
+        hash = fnv1a(hash, entry.Path);
+        hash = fnv1a(hash, std::to_string(static_cast<int>(entry.Group)));
+    }
+    std::vector<std::string> dependencies;
+    for (auto it = manager.fileinfo_begin(); it != manager.fileinfo_end(); ++it) {
+        const clang::FileEntry* entry = it->first;
+        dependencies.emplace_back(
+            entry->getName().str() + ":" +
+            std::to_string(entry->getSize()) + ":" +
+            std::to_string(static_cast<int64_t>(entry->getModificationTime()))
+        );
+    }
+    // the iteration order of fileinfo is not stable
+    std::sort(dependencies.begin(), dependencies.end());
+    for (const std::string& dependency : dependencies) {
+        hash = fnv1a(hash, dependency);
+    }
+    return hash ? hash : 1;
 }
 
 std::string nameSimplify (std::string name) {
@@ -158,6 +264,128 @@ std::string getFullTypeName (clang::QualType type, clang::ASTContext& ctx) {
     return nameSimplify(clang::TypeName::getFullyQualifiedName(type, ctx, ctx.getPrintingPolicy()));
 }
 
+// constraints that drivers can check before calling an API, see __TDD_driver_enum_value
+
+// lower case words of an identifier, split at '_', digits and camelCase : "inBufLen" -> in / buf / len, "URLPath" -> url / path
+std::vector<std::string> splitNameWords (llvm::StringRef name) {
+    std::vector<std::string> words;
+    std::string word;
+    for (size_t idx = 0; idx < name.size(); ++idx) {
+        char c = name[idx];
+        if (!isalpha(c)) {
+            if (!word.empty()) {
+                words.push_back(std::move(word));
+                word.clear();
+            }
+            continue;
+        }
+        if (isupper(c) && !word.empty()) {
+            bool nextLower = idx + 1 < name.size() && islower(name[idx + 1]);
+            if (islower(name[idx - 1]) || nextLower) {
+                words.push_back(std::move(word));
+                word.clear();
+            }
+        }
+        word += (char) (tolower(c));
+    }
+    if (!word.empty()) {
+        words.push_back(std::move(word));
+    }
+    return words;
+}
+
+// whole words only, plus the usual run-together forms ("buflen", "nbytes") : "silent" or "calendar" are not sizes
+bool isSizeLikeName (llvm::StringRef name) {
+    for (const std::string& word : splitNameWords(name)) {
+        llvm::StringRef wordRef (word);
+        if (wordRef.equals("n") || wordRef.equals("length") || wordRef.equals("cnt") ||
+            wordRef.endswith("len") || wordRef.endswith("size") || wordRef.endswith("count") || wordRef.endswith("sz") ||
+            (wordRef.startswith("num") && !wordRef.startswith("numeric")) || (wordRef.startswith("nb") && wordRef.size() > 2)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// whole words only : "profile", "direction" or "redirect" are not paths
+bool isPathLikeName (llvm::StringRef name) {
+    for (const std::string& word : splitNameWords(name)) {
+        llvm::StringRef wordRef (word);
+        if (wordRef.equals("path") || wordRef.equals("file") || wordRef.equals("dir") || wordRef.equals("directory") || wordRef.equals("folder") ||
+            wordRef.equals("infile") || wordRef.equals("outfile") ||
+            wordRef.endswith("path") || wordRef.endswith("filename") || wordRef.endswith("fname") || wordRef.endswith("dirname")) {
+            return true;
+        }
+    }
+    return false;
+}
+
+nlohmann::json getParameterConstraint (clang::FunctionDecl& functionDecl, unsigned idx) {
+    nlohmann::json ret = nlohmann::json::object();
+    const clang::ParmVarDecl& parameter = *functionDecl.getParamDecl(idx);
+    clang::QualType type = parameter.getOriginalType();
+
+    if (const clang::EnumType* enumType = type->getAs<clang::EnumType>()) {
+        const clang::EnumDecl& enumDecl = *enumType->getDecl();
+        nlohmann::json values = nlohmann::json::array();
+        bool allPowerOfTwo = true;
+        int64_t maxValue = 0;
+        for (const clang::EnumConstantDecl* enumerator : enumDecl.enumerators()) {
+            int64_t value = enumerator->getInitVal().getExtValue();
+            values.emplace_back(value);
+            allPowerOfTwo = allPowerOfTwo && value >= 0 && (value & (value - 1)) == 0;
+            maxValue = std::max(maxValue, value);
+        }
+        if (!values.empty()) {
+            ret["enumValues"] = values;
+            // {0, 1, 2} is an ordinary enum, {1, 2, 4} is a set of flags
+            if (enumDecl.hasAttr<clang::FlagEnumAttr>() || (allPowerOfTwo && maxValue >= 4)) {
+                ret["isFlagEnum"] = 1;
+            }
+        }
+    } else if (type->isIntegerType() && isSizeLikeName(parameter.getName())) {
+        // prefer a pointer whose name prefixes this one ("buf" / "buflen"), then the previous parameter
+        std::string lowerName = parameter.getName().lower();
+        int64_t sizeOf = -1;
+        for (unsigned ptrIdx = 0; ptrIdx < idx; ++ptrIdx) {
+            const clang::ParmVarDecl& ptrParameter = *functionDecl.getParamDecl(ptrIdx);
+            std::string lowerPtrName = ptrParameter.getName().lower();
+            if (ptrParameter.getOriginalType()->isPointerType() && !lowerPtrName.empty() && lowerName.find(lowerPtrName) == 0) {
+                sizeOf = ptrIdx;
+            }
+        }
+        if (sizeOf == -1 && idx > 0 && functionDecl.getParamDecl(idx - 1)->getOriginalType()->isPointerType()) {
+            sizeOf = idx - 1;
+        }
+        if (sizeOf != -1) {
+            ret["sizeOf"] = sizeOf;
+        }
+    } else if (type->isPointerType()) {
+        bool nonnull = parameter.hasAttr<clang::NonNullAttr>();
+        for (const clang::NonNullAttr* attr : functionDecl.specific_attrs<clang::NonNullAttr>()) {
+            if (attr->args_size() == 0) {
+                nonnull = true;
+            }
+            for (const clang::ParamIdx& attrIdx : attr->args()) {
+                if (attrIdx.getASTIndex() == idx) {
+                    nonnull = true;
+                }
+            }
+        }
+        if (nonnull) {
+            ret["nonnull"] = 1;
+        }
+        if (type->getPointeeType()->isAnyCharacterType() && isPathLikeName(parameter.getName())) {
+            ret["isPath"] = 1;
+        }
+    }
+    // nameSimplify drops qualifiers from the parameter types, drivers keep loads from a const pointee
+    if ((type->isPointerType() || type->isReferenceType()) && type->getPointeeType().getCanonicalType().isConstQualified()) {
+        ret["pointeeConst"] = 1;
+    }
+    return ret;
+}
+
 bool isInterestingDecl (clang::Decl& decl, clang::ASTContext& ctx) {
     clang::SourceManager& manager = ctx.getSourceManager();
     clang::FullSourceLoc beginLoc = ctx.getFullLoc(decl.getBeginLoc()), endLoc = ctx.getFullLoc(decl.getEndLoc());
@@ -190,9 +418,8 @@ int32_t check (clang::Decl& decl, clang::ASTContext& ctx) {
 
     DYN_CAST (clang::FunctionDecl, pFunctionDecl, &decl) {
         clang::FunctionDecl& functionDecl = *pFunctionDecl;
-        if (
-            functionDecl.getTemplatedKind() != clang::FunctionDecl::TemplatedKind::TK_NonTemplate
-        ) {
+        // template patterns are skipped, their instantiations are kept
+        if (functionDecl.isTemplated()) {
             return 0;
         } else if (llvm::isa<clang::CXXDeductionGuideDecl>(decl)) {
             return 0;
@@ -236,14 +463,47 @@ int32_t check (clang::Decl& decl, clang::ASTContext& ctx) {
     return 2;
 }
 
+// functions are keyed by their mangled name (the plain name for C), which is also what the runtime sees
+std::string getDeclKey (clang::FunctionDecl& functionDecl, clang::MangleContext& mangleContext) {
+    if (!mangleContext.shouldMangleDeclName(&functionDecl)) {
+        return functionDecl.getQualifiedNameAsString();
+    }
+    std::string ret;
+    llvm::raw_string_ostream os(ret);
+    DYN_CAST (clang::CXXConstructorDecl, pConstructorDecl, &functionDecl) {
+        mangleContext.mangleName(clang::GlobalDecl(pConstructorDecl, clang::CXXCtorType::Ctor_Complete), os);
+    } else DYN_CAST (clang::CXXDestructorDecl, pDestructorDecl, &functionDecl) {
+        mangleContext.mangleName(clang::GlobalDecl(pDestructorDecl, clang::CXXDtorType::Dtor_Complete), os);
+    } else {
+        mangleContext.mangleName(clang::GlobalDecl(&functionDecl), os);
+    }
+    os.flush();
+    return ret;
+}
+
+// qualified name with template arguments, used by the driver to call the function
+std::string getCallName (clang::FunctionDecl& functionDecl, clang::ASTContext& ctx) {
+    std::string ret;
+    llvm::raw_string_ostream os(ret);
+    functionDecl.getNameForDiagnostic(os, ctx.getPrintingPolicy(), true);
+    os.flush();
+    return ret;
+}
+
 // visitor
 
 class DeclVisitor : public clang::RecursiveASTVisitor<DeclVisitor> {
 private:
     clang::ASTContext& ctx;
+    std::unique_ptr<clang::MangleContext> mangleContext;
     nlohmann::json info;
 public:
-    explicit DeclVisitor (clang::ASTContext& ctx_) : ctx(ctx_), info(nlohmann::json::object()) {}
+    explicit DeclVisitor (clang::ASTContext& ctx_) : ctx(ctx_), mangleContext(ctx_.createMangleContext()), info(nlohmann::json::object()) {}
+
+    // instantiations used by the case programs are part of the API surface
+    bool shouldVisitTemplateInstantiations () const {
+        return true;
+    }
 
     bool VisitFunctionDecl (clang::FunctionDecl* functionDecl) {
         if (check(*functionDecl, this->ctx) != 2) {return true;}
@@ -256,21 +516,33 @@ public:
             parametersType.emplace_back(parameterType);
         }
         thisFunction["parametersType"] = parametersType;
+        nlohmann::json parametersConstraint = nlohmann::json::array();
+        for (unsigned idx = 0; idx < functionDecl->getNumParams(); ++idx) {
+            parametersConstraint.emplace_back(getParameterConstraint(*functionDecl, idx));
+        }
+        thisFunction["parametersConstraint"] = parametersConstraint;
         thisFunction["isCXXMethod"] = 0;
         DYN_CAST (clang::CXXMethodDecl, i_CXXMethodDecl, functionDecl) {
             thisFunction["isCXXMethod"] = 1;
             thisFunction["isStaticMethod"] = 0;
             thisFunction["isCXXConstructor"] = 0;
+            thisFunction["isConstMethod"] = 0;
             if (i_CXXMethodDecl->isStatic()) {
                 thisFunction["isStaticMethod"] = 1;
             }
+            if (i_CXXMethodDecl->isConst()) {
+                thisFunction["isConstMethod"] = 1;
+            }
             if (llvm::isa<clang::CXXConstructorDecl>(functionDecl)) {
                 thisFunction["isCXXConstructor"] = 1;
             }
         }
 
-        std::string functionName = functionDecl->getQualifiedNameAsString();
-        this->info[functionName] = thisFunction;
+        thisFunction["name"] = getCallName(*functionDecl, ctx);
+        if (!llvm::isa<clang::CXXMethodDecl>(functionDecl) || thisFunction["isStaticMethod"] == 1) {
+            thisFunction["pointerType"] = getFullTypeName(ctx.getPointerType(functionDecl->getType()), ctx);
+        }
+        this->info[getDeclKey(*functionDecl, *mangleContext)] = thisFunction;
 
         return true;
     }
@@ -283,18 +555,19 @@ public:
 class DepVisitor : public clang::RecursiveASTVisitor<DepVisitor> {
 private:
     clang::ASTContext& ctx;
+    std::unique_ptr<clang::MangleContext> mangleContext;
     std::string currentFunction;
     std::map<std::string, std::set<std::string>> calledFunctions;
 
 public:
-    explicit DepVisitor (clang::ASTContext& ctx_) : ctx(ctx_), currentFunction(), calledFunctions() {}
+    explicit DepVisitor (clang::ASTContext& ctx_) : ctx(ctx_), mangleContext(ctx_.createMangleContext()), currentFunction(), calledFunctions() {}
 
     bool VisitFunctionDecl (clang::FunctionDecl* functionDecl) {
         this->currentFunction.clear();
         if (check(*functionDecl, this->ctx) == 0) {return true;}
         if (!functionDecl->hasBody()) {return true;}
 
-        this->currentFunction = functionDecl->getQualifiedNameAsString();
+        this->currentFunction = getDeclKey(*functionDecl, *mangleContext);
         this->calledFunctions[this->currentFunction] = {};
         return true;
     }
@@ -302,11 +575,11 @@ public:
     bool VisitCallExpr (clang::CallExpr* callExpr) {
         clang::FunctionDecl* callee = callExpr->getDirectCallee();
         if (!callee) {return true;}
-        if (!callee->hasBody()) {return true;}
+        // callees defined in other TUs are kept, TDD_CallGraph.py links them by name
         if (check(*callee, ctx) == 0) {return true;}
         if (this->currentFunction.empty()) {return true;}
 
-        this->calledFunctions[this->currentFunction].emplace(callee->getQualifiedNameAsString());
+        this->calledFunctions[this->currentFunction].emplace(getDeclKey(*callee, *mangleContext));
         return true;
     }
 
@@ -316,27 +589,53 @@ public:
 };
 
 class TDDConsumer : public clang::ASTConsumer {
+private:
+    clang::CompilerInstance& CI;
+
 public:
+    explicit TDDConsumer (clang::CompilerInstance& CI_) : CI(CI_) {}
+
     void HandleTranslationUnit (clang::ASTContext &ctx) override {
-        if (checkEnv("TDD_DUMP_DECL") && isInterestingFile(ctx.getSourceManager().getFileEntryForID(ctx.getSourceManager().getMainFileID())->getName())) {
-            clang::TranslationUnitDecl& unit = *ctx.getTranslationUnitDecl();
+        bool dumpDecl = checkEnv("TDD_DUMP_DECL"), getDep = checkEnv("TDD_GET_DEP"), isCase = checkEnv("TDD_CASE");
+        if (!dumpDecl && !getDep && !isCase) {return;}
+        clang::SourceManager& manager = ctx.getSourceManager();
+        llvm::StringRef mainFile = manager.getFileEntryForID(manager.getMainFileID())->getName();
+        if (!isInterestingFile(mainFile)) {
+            // case programs only contribute the template instantiations of target APIs they use, TDD_CASE alone is enough
+            if (!isCase) {return;}
+            dumpDecl = true;
+            getDep = false;
+        }
+        if (!dumpDecl && !getDep) {return;}
+
+        std::string tuPath = getAbsolutePath(mainFile).str().str();
+        uint64_t stamp = getTUStamp(CI);
+        DatabaseEntry entry = loadEntry(tuPath);
+        dumpDecl = dumpDecl && entry.declStamp != stamp;
+        getDep = getDep && entry.depStamp != stamp;
+        if (!dumpDecl && !getDep) {return;}
+
+        clang::TranslationUnitDecl& unit = *ctx.getTranslationUnitDecl();
+        if (dumpDecl) {
             DeclVisitor v(ctx);
             v.TraverseDecl(&unit);
-            openAndUpdate("__TDDDeclarations.json", v.getInfo());
+            entry.declStamp = stamp;
+            entry.decl = v.getInfo().dump();
         }
-        if (checkEnv("TDD_GET_DEP") && isInterestingFile(ctx.getSourceManager().getFileEntryForID(ctx.getSourceManager().getMainFileID())->getName())) {
-            clang::TranslationUnitDecl& unit = *ctx.getTranslationUnitDecl();
+        if (getDep) {
             DepVisitor v(ctx);
             v.TraverseDecl(&unit);
-            openAndUpdate("__TDDAnalysis.json", v.getInfo());
+            entry.depStamp = stamp;
+            entry.dep = v.getInfo().dump();
         }
+        storeEntry(tuPath, entry);
     }
 };
 
 class TDDAction : public clang::PluginASTAction {
 public:
     std::unique_ptr<clang::ASTConsumer> CreateASTConsumer(clang::CompilerInstance &CI, llvm::StringRef _unused) override {
-        return std::make_unique<TDDConsumer>();
+        return std::make_unique<TDDConsumer>(CI);
     }
 
     bool ParseArgs(const clang::CompilerInstance &CI, const std::vector<std::string> &args) override {
@@ -0,0 +1,627 @@
+// native OUS merger, same input / output format as TDD_OUSMerger.py
+// usage : TDD_OUSMerger [__TDDCallingChain*.json ...]
+// chains are merged as a parallel pairwise tree, TDD_MERGE_JOBS sets the thread count
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <dirent.h>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "json.hpp"
+
+#define ASSERT(cond, msg) if (!(cond)) {std::cerr << msg << " !!\n"; abort();} void(0)
+#define LIKELY(x) __builtin_expect(!!(x), 1)
+#define UNLIKELY(x) __builtin_expect(!!(x), 0)
+
+namespace {
+
+enum struct FunctionParameterType {CONST, PTR_SIZE, NULL_PTR, FILE_PATH, PTR, FUNC};
+
+bool checkEnv (const char* env) {
+    const char* envValue = getenv(env);
+    if (envValue && envValue[0] == '1') {return true;}
+    else {return false;}
+}
+
+const std::map<std::string, FunctionParameterType> parameterTypeFromName = {
+    {"CONST",     FunctionParameterType::CONST},
+    {"PTR_SIZE",  FunctionParameterType::PTR_SIZE},
+    {"NULL",      FunctionParameterType::NULL_PTR},
+    {"FILE_PATH", FunctionParameterType::FILE_PATH},
+    {"PTR",       FunctionParameterType::PTR},
+    {"FUNC",      FunctionParameterType::FUNC},
+};
+
+const char* parameterTypeName (FunctionParameterType paramType) {
+    switch (paramType) {
+        case FunctionParameterType::CONST     : return "CONST";
+        case FunctionParameterType::PTR_SIZE  : return "PTR_SIZE";
+        case FunctionParameterType::NULL_PTR  : return "NULL";
+        case FunctionParameterType::FILE_PATH : return "FILE_PATH";
+        case FunctionParameterType::PTR       : return "PTR";
+        case FunctionParameterType::FUNC      : return "FUNC";
+    }
+    return "";
+}
+
+struct FunctionParameter {
+    int64_t idx;
+    FunctionParameterType paramType;
+    int64_t value = 0;
+    int64_t ptrIndex = -1;
+    int64_t offset = 0;
+    std::string name;
+
+    explicit FunctionParameter (const nlohmann::json& j) {
+        idx = j.at("idx").get<int64_t>();
+        std::string typeName = j.at("paramType").get<std::string>();
+        ASSERT (parameterTypeFromName.count(typeName), "Unknown parameter type : " << typeName);
+        paramType = parameterTypeFromName.at(typeName);
+        if (paramType == FunctionParameterType::CONST) {
+            value = j.at("value").get<int64_t>();
+        } else if (paramType == FunctionParameterType::PTR) {
+            ptrIndex = j.at("ptrIndex").get<int64_t>();
+            offset = j.at("offset").get<int64_t>();
+        } else if (paramType == FunctionParameterType::FUNC) {
+            name = j.at("name").get<std::string>();
+        }
+    }
+
+    nlohmann::json dump () const {
+        nlohmann::json ret = {{"idx", idx}, {"paramType", parameterTypeName(paramType)}};
+        if (paramType == FunctionParameterType::CONST) {
+            ret["value"] = value;
+        } else if (paramType == FunctionParameterType::PTR) {
+            ret["ptrIndex"] = ptrIndex;
+            ret["offset"] = offset;
+        } else if (paramType == FunctionParameterType::FUNC) {
+            ret["name"] = name;
+        }
+        return ret;
+    }
+};
+
+struct FunctionCall {
+    std::string name;
+    int64_t ret = -1;
+    std::vector<FunctionParameter> parameters;
+
+    FunctionCall () = default;
+
+    explicit FunctionCall (const nlohmann::json& j) {
+        name = j.at("name").get<std::string>();
+        if (j.count("return")) {
+            ret = j.at("return").get<int64_t>();
+        }
+        for (const nlohmann::json& parameter : j.at("parameters")) {
+            parameters.emplace_back(parameter);
+        }
+    }
+
+    nlohmann::json dump () const {
+        nlohmann::json ret_ = {{"name", name}, {"parameters", nlohmann::json::array()}};
+        for (const FunctionParameter& parameter : parameters) {
+            ret_["parameters"].push_back(parameter.dump());
+        }
+        if (ret != -1) {
+            ret_["return"] = ret;
+        }
+        return ret_;
+    }
+
+    // everything intraCallMatch / interCallMatch compare except pointer indexes,
+    // calls that can match always share a signature
+    std::string signature () const {
+        std::string ret_ = name;
+        for (const FunctionParameter& parameter : parameters) {
+            ret_.push_back('\0');
+            ret_ += std::to_string(parameter.idx);
+            ret_.push_back(':');
+            ret_ += parameterTypeName(parameter.paramType);
+            if (parameter.paramType == FunctionParameterType::CONST) {
+                ret_.push_back(':');
+                ret_ += std::to_string(parameter.value);
+            } else if (parameter.paramType == FunctionParameterType::PTR) {
+                ret_.push_back(':');
+                ret_ += std::to_string(parameter.offset);
+            } else if (parameter.paramType == FunctionParameterType::FUNC) {
+                ret_.push_back(':');
+                ret_ += parameter.name;
+            }
+        }
+        return ret_;
+    }
+};
+
+struct ObjectLoad {
+    int64_t address;
+    int64_t offset;
+    int64_t value;
+
+    explicit ObjectLoad (const nlohmann::json& j) {
+        address = j.at("address").get<int64_t>();
+        offset = j.at("offset").get<int64_t>();
+        value = j.at("value").get<int64_t>();
+    }
+};
+
+struct ObjectUsage {
+    bool isCall;
+    FunctionCall call;
+    std::vector<ObjectLoad> load;
+};
+
+using OUS = std::vector<ObjectUsage>;
+
+// the signatures already match, only the pointer indexes are left
+bool intraCallMatch (const FunctionCall& call1, const FunctionCall& call2) {
+    if (call1.ret != -1 && call2.ret != -1 && call1.ret != call2.ret) {
+        return false;
+    }
+    for (uint64_t idx = 0; idx < call1.parameters.size(); ++idx) {
+        const FunctionParameter &param1 = call1.parameters[idx], &param2 = call2.parameters[idx];
+        if (param1.paramType == FunctionParameterType::PTR && param1.ptrIndex != param2.ptrIndex) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// pointer indexes of a merged chain / graph -> pointer indexes of the graph, kept one to one
+struct PointerMap {
+    std::map<int64_t, int64_t> forward;
+    std::set<int64_t> targets;
+
+    bool count (int64_t idx) const {return forward.count(idx);}
+    int64_t at (int64_t idx) const {return forward.at(idx);}
+    bool isTarget (int64_t idx) const {return targets.count(idx);}
+
+    void bind (int64_t idx, int64_t target) {
+        forward[idx] = target;
+        targets.insert(target);
+    }
+};
+
+bool interCallMatch (const FunctionCall& call1, const FunctionCall& call2, PointerMap& ptrIdxMap) {
+    std::map<int64_t, int64_t> tempPtrIdxMap;
+    std::set<int64_t> tempTargets;
+    auto ptrIdxMatch = [&] (int64_t idx1, int64_t idx2) -> bool {
+        if (ptrIdxMap.count(idx2)) {
+            return idx1 == ptrIdxMap.at(idx2);
+        } else if (tempPtrIdxMap.count(idx2)) {
+            return idx1 == tempPtrIdxMap.at(idx2);
+        } else if (ptrIdxMap.isTarget(idx1) || tempTargets.count(idx1)) {
+            return false;
+        } else {
+            tempPtrIdxMap[idx2] = idx1;
+            tempTargets.insert(idx1);
+            return true;
+        }
+    };
+
+    if (call1.ret != -1 && call2.ret != -1 && !ptrIdxMatch(call1.ret, call2.ret)) {
+        return false;
+    }
+    for (uint64_t idx = 0; idx < call1.parameters.size(); ++idx) {
+        const FunctionParameter &param1 = call1.parameters[idx], &param2 = call2.parameters[idx];
+        if (param1.paramType == FunctionParameterType::PTR && !ptrIdxMatch(param1.ptrIndex, param2.ptrIndex)) {
+            return false;
+        }
+    }
+
+    for (const auto& [idx, target] : tempPtrIdxMap) {
+        ptrIdxMap.bind(idx, target);
+    }
+    return true;
+}
+
+class Graph {
+private:
+    std::vector<FunctionCall> nodes;
+    std::unordered_map<std::string, std::vector<uint64_t>> nodesBySignature;
+    std::map<std::pair<int64_t, int64_t>, int64_t> loadPtrs;
+    std::vector<std::pair<int64_t, int64_t>> loadPtrsOrder;
+    std::vector<std::pair<uint64_t, uint64_t>> edges;
+    // reachables[idx] is the transitive closure from idx, packed 64 nodes per word
+    std::vector<std::vector<uint64_t>> reachables;
+    int64_t nextPtrIdx;
+
+    bool isReachable (uint64_t fromIdx, uint64_t toIdx) const {
+        const std::vector<uint64_t>& words = reachables[fromIdx];
+        return (toIdx >> 6) < words.size() && ((words[toIdx >> 6] >> (toIdx & 63)) & 1);
+    }
+
+    uint64_t appendNode (const FunctionCall& functionCall, const std::string& signature) {
+        nodes.push_back(functionCall);
+        reachables.emplace_back();
+        nodesBySignature[signature].push_back(nodes.size() - 1);
+        return nodes.size() - 1;
+    }
+
+    int64_t getNewIdx (int64_t idx, PointerMap& ptrMap) {
+        if (!ptrMap.count(idx)) {
+            ptrMap.bind(idx, nextPtrIdx++);
+        }
+        return ptrMap.at(idx);
+    }
+
+    void addLoadPtr (std::pair<int64_t, int64_t> key, int64_t value) {
+        loadPtrs[key] = value;
+        loadPtrsOrder.push_back(key);
+    }
+
+public:
+    Graph () : nodes(1), reachables(1), nextPtrIdx(0) {}
+
+    // an edge closing a cycle (self loops included) is refused
+    bool addEdge (uint64_t fromIdx, uint64_t toIdx) {
+        if (fromIdx == toIdx || isReachable(toIdx, fromIdx)) {
+            return false;
+        }
+        edges.emplace_back(fromIdx, toIdx);
+        if (isReachable(fromIdx, toIdx)) {
+            return true;
+        }
+        std::vector<uint64_t> newReachables = reachables[toIdx];
+        newReachables.resize(std::max<uint64_t>(newReachables.size(), (toIdx >> 6) + 1), 0);
+        newReachables[toIdx >> 6] |= uint64_t(1) << (toIdx & 63);
+        for (uint64_t idx = 0; idx < reachables.size(); ++idx) {
+            if (idx != fromIdx && !isReachable(idx, fromIdx)) {
+                continue;
+            }
+            std::vector<uint64_t>& words = reachables[idx];
+            if (words.size() < newReachables.size()) {
+                words.resize(newReachables.size(), 0);
+            }
+            for (uint64_t word = 0; word < newReachables.size(); ++word) {
+                words[word] |= newReachables[word];
+            }
+        }
+        return true;
+    }
+
+    uint64_t addCallNode (FunctionCall functionCall, const std::map<int64_t, int64_t>& loadMap) {
+        if (functionCall.ret != -1) {
+            ASSERT (!loadMap.count(functionCall.ret), "return value " << functionCall.ret << " is loaded");
+        }
+        for (FunctionParameter& param : functionCall.parameters) {
+            if (param.paramType == FunctionParameterType::PTR && loadMap.count(param.ptrIndex)) {
+                param.ptrIndex = loadMap.at(param.ptrIndex);
+            }
+        }
+
+        std::string signature = functionCall.signature();
+        auto it = nodesBySignature.find(signature);
+        if (it != nodesBySignature.end()) {
+            for (uint64_t idx : it->second) {
+                if (intraCallMatch(nodes[idx], functionCall)) {
+                    return idx;
+                }
+            }
+        }
+        if (functionCall.ret != -1 && nextPtrIdx <= functionCall.ret) {
+            nextPtrIdx = functionCall.ret + 1;
+        }
+        for (const FunctionParameter& param : functionCall.parameters) {
+            if (param.paramType == FunctionParameterType::PTR && nextPtrIdx <= param.ptrIndex) {
+                nextPtrIdx = param.ptrIndex + 1;
+            }
+        }
+        return appendNode(functionCall, signature);
+    }
+
+    void addLoadNode (const ObjectLoad& objectLoad, std::map<int64_t, int64_t>& loadMap) {
+        int64_t address = loadMap.count(objectLoad.address) ? loadMap.at(objectLoad.address) : objectLoad.address;
+        std::pair<int64_t, int64_t> key = {address, objectLoad.offset};
+        if (loadPtrs.count(key)) {
+            if (objectLoad.value != loadPtrs.at(key)) {
+                loadMap[objectLoad.value] = loadPtrs.at(key);
+            }
+        } else {
+            addLoadPtr(key, objectLoad.value);
+            nextPtrIdx = std::max(nextPtrIdx, std::max(address, objectLoad.value) + 1);
+        }
+    }
+
+    void loadOUS (const OUS& ous) {
+        uint64_t lastNodeIdx = 0;
+        std::map<int64_t, int64_t> loadMap;
+        for (const ObjectUsage& ou : ous) {
+            if (ou.isCall) {
+                uint64_t thisNodeIdx = addCallNode(ou.call, loadMap);
+                if (addEdge(lastNodeIdx, thisNodeIdx)) {
+                    lastNodeIdx = thisNodeIdx;
+                }
+            } else {
+                addLoadNode(ou.load.front(), loadMap);
+            }
+        }
+    }
+
+    uint64_t addCallNodeFromAnotherOUS (FunctionCall functionCall, PointerMap& ptrMap) {
+        std::string signature = functionCall.signature();
+        auto it = nodesBySignature.find(signature);
+        if (it != nodesBySignature.end()) {
+            for (uint64_t idx : it->second) {
+                if (interCallMatch(nodes[idx], functionCall, ptrMap)) {
+                    return idx;
+                }
+            }
+        }
+        if (functionCall.ret != -1) {
+            functionCall.ret = getNewIdx(functionCall.ret, ptrMap);
+        }
+        for (FunctionParameter& param : functionCall.parameters) {
+            if (param.paramType == FunctionParameterType::PTR) {
+                param.ptrIndex = getNewIdx(param.ptrIndex, ptrMap);
+            }
+        }
+        return appendNode(functionCall, signature);
+    }
+
+    // map a pointer another graph loads, after the pointer it is loaded from
+    void mapLoadedPtr (int64_t ptrIdx, std::map<int64_t, std::pair<int64_t, int64_t>>& loadedBy, PointerMap& ptrMap) {
+        auto it = loadedBy.find(ptrIdx);
+        if (ptrMap.count(ptrIdx) || it == loadedBy.end()) {
+            return;
+        }
+        auto [address, offset] = it->second;
+        loadedBy.erase(it);
+        mapLoadedPtr(address, loadedBy, ptrMap);
+        std::pair<int64_t, int64_t> key = {getNewIdx(address, ptrMap), offset};
+        if (loadPtrs.count(key)) {
+            ptrMap.bind(ptrIdx, loadPtrs.at(key));
+        } else {
+            addLoadPtr(key, getNewIdx(ptrIdx, ptrMap));
+        }
+    }
+
+    // fold another partial graph in, its pointer indexes are remapped as the ones of a chain
+    void mergeGraph (const Graph& other) {
+        PointerMap ptrMap;
+        std::map<int64_t, std::pair<int64_t, int64_t>> loadedBy;
+        for (const std::pair<int64_t, int64_t>& key : other.loadPtrsOrder) {
+            loadedBy[other.loadPtrs.at(key)] = key;
+        }
+        std::vector<uint64_t> nodeMap(other.nodes.size(), 0);
+        for (uint64_t idx = 1; idx < other.nodes.size(); ++idx) {
+            for (const FunctionParameter& param : other.nodes[idx].parameters) {
+                if (param.paramType == FunctionParameterType::PTR) {
+                    mapLoadedPtr(param.ptrIndex, loadedBy, ptrMap);
+                }
+            }
+            nodeMap[idx] = addCallNodeFromAnotherOUS(other.nodes[idx], ptrMap);
+        }
+        for (const std::pair<int64_t, int64_t>& key : other.loadPtrsOrder) {
+            mapLoadedPtr(other.loadPtrs.at(key), loadedBy, ptrMap);
+        }
+        for (const std::pair<uint64_t, uint64_t>& edge : other.edges) {
+            addEdge(nodeMap[edge.first], nodeMap[edge.second]);
+        }
+    }
+
+    void dump (const char* fileName, const std::map<std::string, uint64_t>& reach) const {
+        nlohmann::json j = nlohmann::json::object();
+        j["edges"] = edges;
+        j["loadPtrs"] = nlohmann::json::array();
+        for (const std::pair<int64_t, int64_t>& key : loadPtrsOrder) {
+            j["loadPtrs"].push_back({{key.first, key.second}, loadPtrs.at(key)});
+        }
+        j["nodes"] = nlohmann::json::array({nullptr});
+        j["nodeWeights"] = nlohmann::json::array({1});
+        for (uint64_t idx = 1; idx < nodes.size(); ++idx) {
+            j["nodes"].push_back(nodes[idx].dump());
+            j["nodeWeights"].push_back(1 + (reach.count(nodes[idx].name) ? reach.at(nodes[idx].name) : 0));
+        }
+        j["pointerIdxCount"] = nextPtrIdx;
+        std::ofstream os(fileName);
+        ASSERT (os.is_open(), "can NOT write " << fileName);
+        os << j.dump();
+    }
+};
+
+OUS loadOUSFromFile (const std::string& fileName) {
+    std::ifstream is(fileName);
+    ASSERT (is.is_open(), "can NOT open " << fileName);
+    nlohmann::json j;
+    is >> j;
+    OUS ret;
+    for (const nlohmann::json& ou : j) {
+        std::string type = ou.at("type").get<std::string>();
+        if (type == "CALL") {
+            ret.push_back({true, FunctionCall(ou), {}});
+        } else if (type == "LOAD") {
+            ret.push_back({false, FunctionCall(), {ObjectLoad(ou)}});
+        }
+    }
+    return ret;
+}
+
+const uint64_t MAX_REPEAT_PERIOD = 16;
+
+std::string usageKey (const ObjectUsage& ou) {
+    if (!ou.isCall) {
+        const ObjectLoad& objectLoad = ou.load.front();
+        return "LOAD:" + std::to_string(objectLoad.address) + ":" + std::to_string(objectLoad.offset) + ":" + std::to_string(objectLoad.value);
+    }
+    std::string ret = "CALL:" + std::to_string(ou.call.ret) + ":" + ou.call.signature();
+    for (const FunctionParameter& param : ou.call.parameters) {
+        if (param.paramType == FunctionParameterType::PTR) {
+            ret += ":" + std::to_string(param.ptrIndex);
+        }
+    }
+    return ret;
+}
+
+// same stages as minimizeOUS in TDD_OUSMerger.py
+OUS minimizeOUS (const OUS& ous) {
+    OUS collapsed;
+    std::vector<std::string> keys;
+    for (const ObjectUsage& ou : ous) {
+        collapsed.push_back(ou);
+        keys.push_back(usageKey(ou));
+        for (uint64_t period = 1; period <= std::min<uint64_t>(MAX_REPEAT_PERIOD, keys.size() / 2); ++period) {
+            if (std::equal(keys.end() - period, keys.end(), keys.end() - 2 * period)) {
+                collapsed.resize(collapsed.size() - period);
+                keys.resize(keys.size() - period);
+                break;
+            }
+        }
+    }
+
+    std::set<int64_t> used;
+    OUS ret;
+    for (auto it = collapsed.rbegin(); it != collapsed.rend(); ++it) {
+        if (!it->isCall) {
+            if (!used.count(it->load.front().value)) {
+                continue;
+            }
+            used.insert(it->load.front().address);
+        } else {
+            std::vector<int64_t> ptrIndexes;
+            for (const FunctionParameter& param : it->call.parameters) {
+                if (param.paramType == FunctionParameterType::PTR) {
+                    ptrIndexes.push_back(param.ptrIndex);
+                }
+            }
+            if (it->call.ret != -1 && !used.count(it->call.ret) && ptrIndexes.empty()) {
+                continue;
+            }
+            used.insert(ptrIndexes.begin(), ptrIndexes.end());
+        }
+        ret.push_back(std::move(*it));
+    }
+    std::reverse(ret.begin(), ret.end());
+    return ret;
+}
+
+// API name -> reachable function count, empty without __TDDCallGraph.json (see TDD_CallGraph.py)
+std::map<std::string, uint64_t> loadReachFromFile (const char* fileName = "__TDDCallGraph.json") {
+    std::map<std::string, uint64_t> ret;
+    std::ifstream is(fileName);
+    if (!is.is_open()) {
+        return ret;
+    }
+    nlohmann::json j;
+    is >> j;
+    for (const auto& [name, count] : j.at("apiReach").items()) {
+        ret[name] = count.get<uint64_t>();
+    }
+    return ret;
+}
+
+uint64_t chainReach (const OUS& ous, const std::map<std::string, uint64_t>& reach) {
+    std::map<std::string, uint64_t> names;
+    for (const ObjectUsage& ou : ous) {
+        if (ou.isCall && reach.count(ou.call.name)) {
+            names[ou.call.name] = reach.at(ou.call.name);
+        }
+    }
+    uint64_t ret = 0;
+    for (const auto& [_, count] : names) {
+        ret += count;
+    }
+    return ret;
+}
+
+// job(0) ... job(count - 1) on up to jobs threads
+template <typename Job>
+void parallelFor (uint64_t count, uint64_t jobs, const Job& job) {
+    std::atomic<uint64_t> next(0);
+    auto worker = [&] () {
+        for (uint64_t idx = next++; idx < count; idx = next++) {
+            job(idx);
+        }
+    };
+    std::vector<std::thread> threads;
+    for (uint64_t idx = 1; idx < std::min(jobs, count); ++idx) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+std::vector<std::string> listCallingChains () {
+    std::vector<std::string> ret;
+    DIR* dir = opendir(".");
+    ASSERT (dir, "can NOT list the current directory");
+    while (dirent* entry = readdir(dir)) {
+        std::string fileName = entry->d_name;
+        if (fileName.rfind("__TDDCallingChain", 0) == 0) {
+            ret.push_back(fileName);
+        }
+    }
+    closedir(dir);
+    std::sort(ret.begin(), ret.end());
+    return ret;
+}
+
+} // namespace (anonymous)
+
+int main (int argc, char** argv) {
+    std::vector<std::string> args(argv + 1, argv + argc);
+    if (args.empty()) {
+        args = listCallingChains();
+    }
+    ASSERT (!args.empty(), "no calling chain to merge");
+
+    std::map<std::string, uint64_t> reach = loadReachFromFile();
+    std::vector<OUS> chains;
+    for (const std::string& fileName : args) {
+        chains.push_back(loadOUSFromFile(fileName));
+    }
+    if (!checkEnv("TDD_NO_MINIMIZE")) {
+        for (OUS& chain : chains) {
+            chain = minimizeOUS(chain);
+        }
+    }
+    if (!reach.empty()) {
+        // the chain reaching the most code becomes the base graph
+        std::vector<uint64_t> order(args.size()), chainReaches(args.size());
+        for (uint64_t idx = 0; idx < args.size(); ++idx) {
+            order[idx] = idx;
+            chainReaches[idx] = chainReach(chains[idx], reach);
+        }
+        std::stable_sort(order.begin(), order.end(), [&] (uint64_t a, uint64_t b) {return chainReaches[a] > chainReaches[b];});
+        std::vector<std::string> sortedArgs;
+        std::vector<OUS> sortedChains;
+        for (uint64_t idx : order) {
+            sortedArgs.push_back(std::move(args[idx]));
+            sortedChains.push_back(std::move(chains[idx]));
+        }
+        args = std::move(sortedArgs);
+        chains = std::move(sortedChains);
+    }
+
+    uint64_t jobs = std::max(1u, std::thread::hardware_concurrency());
+    if (const char* env = getenv("TDD_MERGE_JOBS")) {
+        jobs = std::max<uint64_t>(1, strtoull(env, nullptr, 10));
+    }
+
+    std::cout << "Merge " << nlohmann::json(args).dump() << "\n";
+    std::vector<Graph> graphs(chains.size());
+    parallelFor(chains.size(), jobs, [&] (uint64_t idx) {graphs[idx].loadOUS(chains[idx]);});
+    // pairwise over the chain order, the tree does not depend on the number of jobs
+    while (graphs.size() > 1) {
+        parallelFor(graphs.size() / 2, jobs, [&] (uint64_t idx) {graphs[2 * idx].mergeGraph(graphs[2 * idx + 1]);});
+        std::vector<Graph> merged;
+        for (uint64_t idx = 0; idx < graphs.size(); idx += 2) {
+            merged.push_back(std::move(graphs[idx]));
+        }
+        graphs = std::move(merged);
+    }
+    graphs.front().dump("__TDDFinalCallingChain.json", reach);
+    return 0;
+}
@@ -1,10 +1,11 @@
-from collections import defaultdict
 from copy import deepcopy
 import enum
 import json
 import os
 import sys
-from typing import DefaultDict, Dict, List, Set, Tuple, Union
+from typing import Dict, List, Set, Tuple, Union
+
+from TDD_CallGraph import loadReachFromFile
 
 class ObjectLoad:
     __slots__ = ("_address", "_offset", "_value")
@@ -115,16 +116,45 @@ def intraCallMatch(call1 : FunctionCall, call2 : FunctionCall) -> bool:
 
     return True
 
-def interCallMatch(call1 : FunctionCall, call2 : FunctionCall, ptrIdxMap : Dict[int, int]) -> bool:
+class PointerMap:
+    """
+    pointer indexes of a merged chain -> pointer indexes of the graph, kept one to one
+    """
+    __slots__ = ("_forward", "_targets")
+    _forward : Dict[int, int]
+    _targets : Set[int]
+
+    def __init__(self):
+        self._forward = {}
+        self._targets = set()
+
+    def __contains__(self, idx : int) -> bool:
+        return idx in self._forward
+
+    def __getitem__(self, idx : int) -> int:
+        return self._forward[idx]
+
+    def isTarget(self, idx : int) -> bool:
+        return idx in self._targets
+
+    def bind(self, idx : int, target : int):
+        self._forward[idx] = target
+        self._targets.add(target)
+
+def interCallMatch(call1 : FunctionCall, call2 : FunctionCall, ptrIdxMap : PointerMap) -> bool:
     tempPtrIdxMap : Dict[int, int] = {}
+    tempTargets : Set[int] = set()
     def ptrIdxMatch(idx1 : int, idx2 : int):
-        nonlocal tempPtrIdxMap
         if idx2 in ptrIdxMap:
             return idx1 == ptrIdxMap[idx2]
         elif idx2 in tempPtrIdxMap:
             return idx1 == tempPtrIdxMap[idx2]
+        elif ptrIdxMap.isTarget(idx1) or idx1 in tempTargets:
+            # two pointers of the merged chain can not become one pointer of the graph
+            return False
         else:
             tempPtrIdxMap[idx2] = idx1
+            tempTargets.add(idx1)
             return True
 
     if call1._name != call2._name:
@@ -145,7 +175,8 @@ def interCallMatch(call1 : FunctionCall, call2 : FunctionCall, ptrIdxMap : Dict[
         elif param1._paramType == FunctionCall.FunctionParameterType.FUNC and param1._name != param2._name:
             return False
 
-    ptrIdxMap.update(tempPtrIdxMap)
+    for idx, target in tempPtrIdxMap.items():
+        ptrIdxMap.bind(idx, target)
     return True
 
 class Graph:
@@ -153,7 +184,7 @@ class Graph:
     _nodes : List[FunctionCall]
     _loadPtrs : Dict[Tuple[int, int], int]
     _edges : List[Tuple[int, int]]
-    _reachables : DefaultDict[int, List[int]]
+    _reachables : List[int]
     _nodeCount : int
     _nextPtrIdx : int
 
@@ -161,20 +192,25 @@ class Graph:
         self._nodes = [None, ]
         self._loadPtrs = {}
         self._edges = []
-        self._reachables = defaultdict(list)
+        self._reachables = [0, ]
         self._nodeCount = 1
         self._nextPtrIdx = 0
 
     def addEdge(self, fromIdx : int, toIdx : int) -> bool:
-        if fromIdx not in self._reachables[toIdx]:
-            self._edges.append((fromIdx, toIdx))
-            self._reachables[fromIdx].append(toIdx)
-            for reachable in self._reachables.values():
-                if fromIdx in reachable:
-                    reachable.append(toIdx)
-            return True
-        else:
+        """
+        _reachables[idx] is the transitive closure from idx, a python int used as a bitset over nodes.
+        an edge closing a cycle (self loops included) is refused.
+        """
+        if fromIdx == toIdx or (self._reachables[toIdx] >> fromIdx) & 1:
             return False
+        self._edges.append((fromIdx, toIdx))
+        if not (self._reachables[fromIdx] >> toIdx) & 1:
+            newReachables = self._reachables[toIdx] | (1 << toIdx)
+            fromBit = 1 << fromIdx
+            for idx, reachables in enumerate(self._reachables):
+                if idx == fromIdx or reachables & fromBit:
+                    self._reachables[idx] = reachables | newReachables
+        return True
 
     def addCallNode(self, functionCall : FunctionCall, loadMap : Dict[int, int]) -> int:
         if functionCall._return != -1:
@@ -187,6 +223,7 @@ class Graph:
             if intraCallMatch(preFunctionCall, functionCall):
                 return idx
         self._nodes.append(functionCall)
+        self._reachables.append(0)
         if functionCall._return != -1 and self._nextPtrIdx <= functionCall._return:
             self._nextPtrIdx = functionCall._return + 1
         for param in functionCall._parameters:
@@ -196,12 +233,14 @@ class Graph:
         return self._nodeCount - 1
 
     def addLoadNode(self, objectLoad : ObjectLoad, loadMap : Dict[int, int]):
-        key = (objectLoad._address, objectLoad._offset)
+        address = loadMap.get(objectLoad._address, objectLoad._address)
+        key = (address, objectLoad._offset)
         if key in self._loadPtrs:
             if objectLoad._value != self._loadPtrs[key]:
                 loadMap[objectLoad._value] = self._loadPtrs[key]
         else:
             self._loadPtrs[key] = objectLoad._value
+            self._nextPtrIdx = max(self._nextPtrIdx, address + 1, objectLoad._value + 1)
 
     def loadOUS(self, OUS : List[Union[FunctionCall, ObjectLoad]]):
         lastNodeIdx = 0
@@ -216,13 +255,13 @@ class Graph:
             else:
                 assert False, f"Unknown ou type : {type(ou)}"
 
-    def getNewIdx(self, idx : int, ptrMap : Dict[int, int]) -> int:
+    def getNewIdx(self, idx : int, ptrMap : PointerMap) -> int:
         if idx not in ptrMap:
-            ptrMap[idx] = self._nextPtrIdx
+            ptrMap.bind(idx, self._nextPtrIdx)
             self._nextPtrIdx += 1
         return ptrMap[idx]
 
-    def addCallNodeFromAnotherOUS(self, functionCall : FunctionCall, ptrMap : Dict[int, int]) -> int:
+    def addCallNodeFromAnotherOUS(self, functionCall : FunctionCall, ptrMap : PointerMap) -> int:
         for idx, preFunctionCall in enumerate(self._nodes[1:], 1):
             if interCallMatch(preFunctionCall, functionCall, ptrMap):
                 return idx
@@ -232,21 +271,22 @@ class Graph:
             if param._paramType == FunctionCall.FunctionParameterType.PTR:
                 param._ptrIndex = self.getNewIdx(param._ptrIndex, ptrMap)
         self._nodes.append(functionCall)
+        self._reachables.append(0)
         self._nodeCount += 1
         return self._nodeCount - 1
 
-    def addLoadNodeFromAnotherOUS(self, objectLoad : ObjectLoad, ptrMap : Dict[int, int]):
+    def addLoadNodeFromAnotherOUS(self, objectLoad : ObjectLoad, ptrMap : PointerMap):
         assert objectLoad._value not in ptrMap
         mappedAddress = self.getNewIdx(objectLoad._address, ptrMap)
         key = (mappedAddress, objectLoad._offset)
         if key in self._loadPtrs:
-            ptrMap[objectLoad._value] = self._loadPtrs[key]
+            ptrMap.bind(objectLoad._value, self._loadPtrs[key])
         else:
             self._loadPtrs[key] = self.getNewIdx(objectLoad._value, ptrMap)
 
     def loadAnotherOUS(self, OUS : List[Union[FunctionCall, ObjectLoad]]):
         lastNodeIdx = 0
-        ptrMap : Dict[int, int] = {}
+        ptrMap = PointerMap()
         for ou in OUS:
             if isinstance(ou, FunctionCall):
                 thisNodeIdx = self.addCallNodeFromAnotherOUS(ou, ptrMap)
@@ -257,15 +297,16 @@ class Graph:
             else:
                 assert False, f"Unknown ou type : {type(ou)}"
 
-    def dump(self, fileName : str):
+    def dump(self, fileName : str, reach : Dict[str, int]):
         dic = {
             "edges" : list(self._edges),
             "loadPtrs" : tuple(self._loadPtrs.items()),
             "nodes" : [subNode.dump() if subNode else None for subNode in self._nodes],
+            "nodeWeights" : [1 + reach.get(subNode._name, 0) if subNode else 1 for subNode in self._nodes],
             "pointerIdxCount" : self._nextPtrIdx,
         }
         with open(fileName, "wt") as f:
-            json.dump(dic, f, indent = 4)
+            json.dump(dic, f, separators = (",", ":"))
 
 def loadOUSFromFile(file : str) -> List[Union[FunctionCall, ObjectLoad]]:
     with open(file, "rt") as f:
@@ -278,14 +319,61 @@ def loadOUSFromFile(file : str) -> List[Union[FunctionCall, ObjectLoad]]:
             ret.append(FunctionCall(dic))
     return ret
 
+MAX_REPEAT_PERIOD : int = 16
+
+def minimizeOUS(OUS : List[Union[FunctionCall, ObjectLoad]]) -> List[Union[FunctionCall, ObjectLoad]]:
+    """
+    collapse back-to-back repeats of the same block (up to MAX_REPEAT_PERIOD usages, pointers included),
+    then walk backward and drop loads whose value is never used, and calls without pointer arguments
+    whose returned pointer is never used. pointers used by the kept usages stay produced.
+    """
+    collapsed : List[Union[FunctionCall, ObjectLoad]] = []
+    keys : List[str] = []
+    for ou in OUS:
+        collapsed.append(ou)
+        keys.append(json.dumps(ou.dump(), sort_keys = True))
+        for period in range(1, min(MAX_REPEAT_PERIOD, len(keys) // 2) + 1):
+            if keys[-period :] == keys[-2 * period : -period]:
+                del collapsed[-period :]
+                del keys[-period :]
+                break
+
+    used : Set[int] = set()
+    ret : List[Union[FunctionCall, ObjectLoad]] = []
+    for ou in reversed(collapsed):
+        if isinstance(ou, ObjectLoad):
+            if ou._value not in used:
+                continue
+            used.add(ou._address)
+        else:
+            ptrIndexes = [param._ptrIndex for param in ou._parameters if param._paramType == FunctionCall.FunctionParameterType.PTR]
+            if ou._return != -1 and ou._return not in used and not ptrIndexes:
+                continue
+            used.update(ptrIndexes)
+        ret.append(ou)
+    ret.reverse()
+    return ret
+
+def chainReach(OUS : List[Union[FunctionCall, ObjectLoad]], reach : Dict[str, int]) -> int:
+    return sum(reach.get(name, 0) for name in set(ou._name for ou in OUS if isinstance(ou, FunctionCall)))
+
 if __name__ == "__main__":
     graph = Graph()
     if len(sys.argv) == 1:
         args = [x for x in os.listdir(".") if x.startswith("__TDDCallingChain")]
     else:
         args = sys.argv[1:]
+    reach = loadReachFromFile()
+    chains = [loadOUSFromFile(file) for file in args]
+    if not os.environ.get("TDD_NO_MINIMIZE", "").startswith("1"):
+        chains = [minimizeOUS(chain) for chain in chains]
+    if reach:
+        # the chain reaching the most code becomes the base graph
+        order = sorted(range(len(args)), key = lambda idx : -chainReach(chains[idx], reach))
+        args = [args[idx] for idx in order]
+        chains = [chains[idx] for idx in order]
     print(f"Merge {args}")
-    graph.loadOUS(loadOUSFromFile(args[0]))
-    for file in args[1:]:
-        graph.loadAnotherOUS(loadOUSFromFile(file))
-    graph.dump("__TDDFinalCallingChain.json")
\ No newline at end of file
+    graph.loadOUS(chains[0])
+    for chain in chains[1:]:
+        graph.loadAnotherOUS(chain)
+    graph.dump("__TDDFinalCallingChain.json", reach)
\ No newline at end of file
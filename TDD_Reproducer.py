@@ -0,0 +1,171 @@
+# !/usr/bin/env python3
+# coding = utf-8
+
+import glob
+import os
+import re
+import sys
+from typing import Dict, List, Tuple
+
+class ReproducerConfig:
+    # configs
+    DRIVER_FILE     : str = "__TDDDriver.cc"
+    DRIVER_EXE      : str = "__TDDDriver.cov.exe"
+    REPRODUCER_FILE : str = "__TDDReproducer.cc"
+    REPRODUCER_EXE  : str = "__TDDReproducer.exe"
+    BYTES_PER_LINE  : int = 16
+
+    def __init__(self):
+        assert False, "class ReproducerConfig can NOT be initialized"
+
+class TraceRecord:
+    __slots__ = ("node", "section", "offset", "bytesRead", "result", "nullPointers")
+    node : int
+    # -1 before the first section (setup nodes) and in unsectioned inputs
+    section : int
+    offset : int
+    bytesRead : int
+    # "end", "fail", or "" if the node did not return
+    result : str
+    nullPointers : List[int]
+
+    def __init__(self, node : int, section : int, offset : int):
+        self.node = node
+        self.section = section
+        self.offset = offset
+        self.bytesRead = 0
+        self.result = ""
+        self.nullPointers = []
+
+def readTrace(fileName : str) -> Tuple[int, List[TraceRecord]]:
+    """
+    the input size and the nodes of a TDD_DRIVER_TRACE log, in the order they ran.
+    """
+    assert os.path.exists(fileName), f"{fileName} does not exist"
+    size = -1
+    records : List[TraceRecord] = []
+    with open(fileName, "rt") as f:
+        for line in f:
+            kind, *values = line.split()
+            values = [int(value) for value in values]
+            if kind == "input":
+                size = values[0]
+            elif kind == "node":
+                records.append(TraceRecord(values[0], values[1], values[2]))
+            elif kind in ("end", "fail"):
+                assert records and records[-1].node == values[0], f"{kind} of node {values[0]} without its begin"
+                records[-1].result = kind
+                records[-1].bytesRead = values[1]
+            elif kind == "null":
+                assert records, f"null pointer {values[0]} outside a node"
+                records[-1].nullPointers.append(values[0])
+            else:
+                assert False, f"unknown trace record : {line.strip()}"
+    assert size != -1, f"{fileName} has no input record"
+    return size, records
+
+def shardFiles(driverFile : str) -> List[str]:
+    """
+    __TDDDriver.0.cc ... of a driver generated with "$ driver shards", empty for a single file.
+    """
+    stem = os.path.splitext(driverFile)[0]
+    shards = [fileName for fileName in glob.glob(f"{stem}.*.cc") if re.fullmatch(r"\d+", fileName[len(stem) + 1 : -3])]
+    return sorted(shards, key = lambda fileName : int(fileName[len(stem) + 1 : -3]))
+
+def readNodeBodies(fileNames : List[str]) -> Dict[int, List[str]]:
+    """
+    the statements of every __TDD_node_N in the driver and its shards, without the final "return true;".
+    """
+    bodies : Dict[int, List[str]] = {}
+    for fileName in fileNames:
+        assert os.path.exists(fileName), f"{fileName} does not exist"
+        current = None
+        with open(fileName, "rt") as f:
+            for line in f:
+                line = line.rstrip("\n")
+                match = re.match(r"^(?:static )?bool __TDD_node_(\d+) \(\) \{$", line)
+                if match:
+                    current = bodies.setdefault(int(match.group(1)), [])
+                elif line == "}":
+                    if current and current[-1].strip() == "return true;":
+                        current.pop()
+                    current = None
+                elif current is not None:
+                    current.append(line)
+    return bodies
+
+def readCompileCommand(fileName : str) -> str:
+    """
+    the driver's coverage compile command (-O0, debug information), building the reproducer without libFuzzer.
+    the reproducer includes the shards, they are not compiled on their own.
+    """
+    with open(fileName, "rt") as f:
+        for line in f:
+            if line.startswith(" * Coverage Compile Command : "):
+                command = line[len(" * Coverage Compile Command : ") :].strip()
+                command = command.replace(",fuzzer", "").replace("fuzzer,", "")
+                command = command.replace(f"-o {ReproducerConfig.DRIVER_EXE} {os.path.basename(fileName)}", f"-o {ReproducerConfig.REPRODUCER_EXE} {ReproducerConfig.REPRODUCER_FILE}")
+                for shardFile in shardFiles(fileName):
+                    command = command.replace(f" {os.path.basename(shardFile)} ", " ")
+                return command
+    return ""
+
+def generate(inputFile : str, traceFile : str, driverFile : str) -> str:
+    size, records = readTrace(traceFile)
+    shards = shardFiles(driverFile)
+    bodies = readNodeBodies([driverFile] + shards)
+    with open(inputFile, "rb") as f:
+        data = f.read()
+    assert len(data) == size, f"{inputFile} has {len(data)} bytes, the trace was written for {size}"
+    assert size, "an empty input runs no node"
+
+    lines : List[str] = []
+    lines.append(f"/* TDD reproducer of {inputFile} from {traceFile}")
+    lines.append(f" * Compile Command : {readCompileCommand(driverFile)}")
+    lines.append(" */")
+    lines.append("")
+    lines.append("#define LLVMFuzzerTestOneInput __TDD_reproducer_unused")
+    lines.append(f"#include \"{os.path.basename(driverFile)}\"")
+    lines.extend(f"#include \"{os.path.basename(shardFile)}\"" for shardFile in shards)
+    lines.append("#undef LLVMFuzzerTestOneInput")
+    lines.append("")
+    lines.append("const uint8_t __TDD_input[] = {")
+    for begin in range(0, size, ReproducerConfig.BYTES_PER_LINE):
+        chunk = data[begin : begin + ReproducerConfig.BYTES_PER_LINE]
+        lines.append("    " + ", ".join(f"0x{byte:02x}" for byte in chunk) + ",")
+    lines.append("};")
+    lines.append("")
+    lines.append("int main () {")
+    lines.append("    using namespace TDD;")
+    lines.append("    __TDD_driver_init(__TDD_input, sizeof (__TDD_input));")
+    for record in records:
+        assert record.node in bodies, f"node {record.node} is not in {driverFile}"
+        if record.result == "end":
+            summary = f"{record.bytesRead} bytes"
+        elif record.result == "fail":
+            summary = f"{record.bytesRead} bytes, returned false"
+        else:
+            summary = "did not return"
+        lines.append("")
+        section = "__TDD_UNEG1" if record.section == -1 else f"{record.section}"
+        lines.append(f"    // node {record.node} : section {record.section} offset {record.offset}, {summary}")
+        for ptrIndex in record.nullPointers:
+            lines.append(f"    // pointer {ptrIndex} is loaded as null")
+        lines.append(f"    __TDD_driver_seek({section}, {record.offset});")
+        lines.append("    {")
+        lines.extend(f"    {line}" if line else line for line in bodies[record.node])
+        lines.append("    }")
+    lines.append("")
+    lines.append("    __TDD_driver_fin();")
+    lines.append("    return 0;")
+    lines.append("}")
+    return "\n".join(lines) + "\n"
+
+if __name__ == "__main__":
+    if len(sys.argv) not in (3, 4):
+        raise ValueError(f"Usage : python {sys.argv[0]} <trace> <input> [driver, default {ReproducerConfig.DRIVER_FILE}]")
+    driverFile = sys.argv[3] if len(sys.argv) == 4 else ReproducerConfig.DRIVER_FILE
+    reproducer = generate(sys.argv[2], sys.argv[1], driverFile)
+    with open(os.path.join(os.path.dirname(driverFile), ReproducerConfig.REPRODUCER_FILE), "wt") as f:
+        f.write(reproducer)
+    print(f"{ReproducerConfig.REPRODUCER_FILE} written, build it with : {readCompileCommand(driverFile)}")
@@ -20,12 +20,15 @@ cp $TDD/file/* src
 TDD_DUMP_DECL=1 TDD_CASE=1 make -j1
 cd src
 
+# materialize __TDDDeclarations.json from __TDDDatabase
+python $TDD/TDD_Database.py
+
 # execute cases & get OUS
 ./file -m magic.mgc ./file
 cp __TDDCallingChain.json __TDDCallingChain.file.json
 
 # merge OUS & build fuzz driver
-python $TDD/TDD_OUSMerger.py __TDDCallingChain.file.json
+$TDD/TDD_OUSMerger __TDDCallingChain.file.json
 python $TDD/TDD_DriverGenerator.py
 
 # fix errors & memory leaks
@@ -45,8 +48,13 @@ python $TDD/set.py fuzzing
 make
 cd src
 cp ../../DriverBuilder/src/__TDDDriver.cc .
-$LLVM_DIR/build_release/bin/clang++ -gdwarf-4 -fstandalone-debug -O0 -DNDEBUG -Xclang -disable-O0-optnone -fPIC -fsanitize=address,fuzzer -fprofile-instr-generate -fcoverage-mapping -std=c++17 -o __TDDDriver.exe __TDDDriver.cc -I ../../src -I . ./.libs/libmagic.so -DHAVE_STRCASESTR
+# (optional) with "$ driver shards" in __TDDCaseConfig, copy the header, shards and makefile as well and build them in parallel
+# cp ../../DriverBuilder/src/__TDDDriver.* . && make -f __TDDDriver.mk -j$(nproc)
+$LLVM_DIR/build_release/bin/clang++ -gdwarf-4 -O2 -DNDEBUG -fPIC -fsanitize=address -std=c++17 -c -o __TDDDriver.o __TDDDriver.cc -I ../../src -I . -DHAVE_STRCASESTR
+$LLVM_DIR/build_release/bin/clang++ -fsanitize=address,fuzzer -fprofile-instr-generate -o __TDDDriver.exe __TDDDriver.o ./.libs/libmagic.so
 LD_LIBRARY_PATH=./.libs ./__TDDDriver.exe
+# (optional) coverage report of the corpus, with the "Coverage Compile Command" in __TDDDriver.cc
+# $LLVM_DIR/build_release/bin/clang++ -gdwarf-4 -fstandalone-debug -O0 -DNDEBUG -Xclang -disable-O0-optnone -fPIC -fsanitize=address,fuzzer -fprofile-instr-generate -fcoverage-mapping -std=c++17 -o __TDDDriver.cov.exe __TDDDriver.cc -I ../../src -I . ./.libs/libmagic.so -DHAVE_STRCASESTR
 
 # show crash
 cp $TDD/file/crash-* .
@@ -22,14 +22,24 @@ TDD_DUMP_DECL=1 ninja -j1
 TDD_CASE=1 $LLVM_DIR/build_release/bin/clang ftsample.c -o ftsample.exe -gdwarf-4 -fstandalone-debug -O0 -Xclang -disable-O0-optnone -fPIC -DNDEBUG -fplugin=/home/frokaikan/Desktop/workspace/passes/TDD_NewSuite.so -fpass-plugin=/home/frokaikan/Desktop/workspace/passes/TDD_NewPasses.so -I ../include -I ../include/freetype libfreetype.a -lz -lbz2 -lpng -lbrotlidec $TDD/TDD_Interceptors.so -DFT2_BUILD_LIBRARY
 TDD_CASE=1 $LLVM_DIR/build_release/bin/clang test_afm.c -o test_afm.exe -gdwarf-4 -fstandalone-debug -O0 -Xclang -disable-O0-optnone -fPIC -DNDEBUG -fplugin=/home/frokaikan/Desktop/workspace/passes/TDD_NewSuite.so -fpass-plugin=/home/frokaikan/Desktop/workspace/passes/TDD_NewPasses.so -I ../include -I ../include/freetype libfreetype.a -lz -lbz2 -lpng -lbrotlidec $TDD/TDD_Interceptors.so -DFT2_BUILD_LIBRARY
 
+# materialize __TDDDeclarations.json from __TDDDatabase, with the instantiations the cases use
+python $TDD/TDD_Database.py
+
 # execute cases & get OUS
 ./test_afm.exe sample.afm
 cp __TDDCallingChain.json __TDDCallingChain.testafm.json
 ./ftsample.exe codicon.ttf
 cp __TDDCallingChain.json __TDDCallingChain.ftsample.json
 
+# (optional) keep the chains covering the most target code
+# needs cases built with the `set.py fuzzing` flags and a "$ replay" section in __TDDCaseConfig, e.g.
+#   __TDDCallingChain.ftsample.json ./ftsample.cov.exe codicon.ttf
+# plus a "$ replay objects" section listing instrumented shared libraries, if the target is one
+# python $TDD/TDD_ChainSelector.py
+# $TDD/TDD_OUSMerger $(cat __TDDSelectedChains)
+
 # merge OUS & build fuzz driver
-python $TDD/TDD_OUSMerger.py __TDDCallingChain.ftsample.json __TDDCallingChain.testafm.json
+$TDD/TDD_OUSMerger __TDDCallingChain.ftsample.json __TDDCallingChain.testafm.json
 python $TDD/TDD_DriverGenerator.py
 
 # fix errors & memory leaks
@@ -47,9 +57,17 @@ python $TDD/set.py fuzzing
 cmake .. -GNinja
 ninja
 cp ../DriverBuilder/__TDDDriver.cc .
-$LLVM_DIR/build_release/bin/clang++ -gdwarf-4 -fstandalone-debug -O0 -DNDEBUG -Xclang -disable-O0-optnone -fPIC -fsanitize=address,fuzzer -fprofile-instr-generate -fcoverage-mapping -std=c++17 -o __TDDDriver.exe __TDDDriver.cc -I ../include -I ../include/freetype libfreetype.a -lz -lbz2 -lpng -lbrotlidec
+# (optional) with "$ driver shards" in __TDDCaseConfig, copy the header, shards and makefile as well and build them in parallel
+# cp ../DriverBuilder/__TDDDriver.* . && make -f __TDDDriver.mk -j$(nproc)
+$LLVM_DIR/build_release/bin/clang++ -gdwarf-4 -O2 -DNDEBUG -fPIC -fsanitize=address -std=c++17 -c -o __TDDDriver.o __TDDDriver.cc -I ../include -I ../include/freetype
+$LLVM_DIR/build_release/bin/clang++ -fsanitize=address,fuzzer -fprofile-instr-generate -o __TDDDriver.exe __TDDDriver.o libfreetype.a -lz -lbz2 -lpng -lbrotlidec
 ./__TDDDriver.exe
+# (optional) coverage report of the corpus, with the "Coverage Compile Command" in __TDDDriver.cc
+# $LLVM_DIR/build_release/bin/clang++ -gdwarf-4 -fstandalone-debug -O0 -DNDEBUG -Xclang -disable-O0-optnone -fPIC -fsanitize=address,fuzzer -fprofile-instr-generate -fcoverage-mapping -std=c++17 -o __TDDDriver.cov.exe __TDDDriver.cc -I ../include -I ../include/freetype libfreetype.a -lz -lbz2 -lpng -lbrotlidec
 
 # show crash
 cp $TDD/freetype/crash-* .
-./__TDDDriver.exe crash-*
\ No newline at end of file
+./__TDDDriver.exe crash-*
+# (optional) straight-line reproducer of the crash
+# TDD_DRIVER_TRACE=__TDDTrace ./__TDDDriver.exe crash-*
+# python $TDD/TDD_Reproducer.py __TDDTrace crash-*
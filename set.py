@@ -54,6 +54,7 @@ elif len(sys.argv) == 2 and sys.argv[1] == "compile":
 $CXX -gdwarf-4 -fstandalone-debug -O3 -Xclang -disable-O0-optnone -fPIC -std=c++17 -DNDEBUG -shared TDD_NewPasses.cc -o TDD_NewPasses.so -I $LLVM_DIR/llvm/include/ -I $LLVM_DIR/build_release/include/
 $CXX -gdwarf-4 -fstandalone-debug -O3 -Xclang -disable-O0-optnone -fPIC -std=c++17 -DNDEBUG -shared TDD_Interceptors.cc -o TDD_Interceptors.so -ldl
 $CXX -gdwarf-4 -fstandalone-debug -O3 -Xclang -disable-O0-optnone -fPIC -std=c++17 -DNDEBUG -shared TDD_NewSuite.cc -o TDD_NewSuite.so -I $LLVM_DIR/clang/include/ -I $LLVM_DIR/build_release/tools/clang/include/ -I $LLVM_DIR/llvm/include/ -I $LLVM_DIR/build_release/include/
+$CXX -O3 -std=c++17 -DNDEBUG TDD_OUSMerger.cc -o TDD_OUSMerger -pthread
 
 -fpass-plugin=$TDD/TDD_NewPasses.so
 -fplugin=$TDD/TDD_NewSuite.so
@@ -62,8 +63,13 @@ elif len(sys.argv) == 2 and sys.argv[1] == "showEnv":
     data = f"""
 TDD_DUMP_DECL (suite - instrument)
 TDD_GET_DEP (suite - instrument)
-TDD_CASE (case - instrument)
+TDD_CASE (case - instrument, also dumps the template instantiations a case uses)
 TDD_NO_CHAIN (case - execute)
+TDD_MERGE_JOBS (merge)
+TDD_NO_MINIMIZE (merge)
+TDD_DRIVER_FORK (driver - execute)
+TDD_DRIVER_TRACE (driver - execute)
+TDD_DRIVER_STATS (driver - execute)
 $ target (target files)
 $ case (case files)
 $ pre operations
@@ -72,6 +78,10 @@ $ min size
 $ max size
 $ no const int
 $ opaque types
+$ no setup reuse
+$ driver shards
+$ replay (chain selection)
+$ replay objects (chain selection, instrumented shared libraries)
 """
 else:
     raise ValueError(f"Usage : eval $(python {sys.argv[0]} normal | fuzzing | unset | fullUnset | compile | showEnv)")